@@ -0,0 +1,221 @@
+// See LICENSE for license details.
+
+// cache_core_t：把 replacement policy 當成 template 參數的 cache_sim_t
+// hit() / victimize() 直接呼叫 policy 的 inline function，不用 virtual，
+// ways 是 1 / 2 / 4 / 8 / 16 時還會把 WAYS 當成常數，比對 tag 的迴圈可以整個展開
+// 只給 cachesim.cc 的 construct() 用 (access_batch_impl 定義在那裡)
+//
+// 每個 set 的狀態擠在同一筆 record 裡 (不再是 tags / stamp / freq 三個分開的陣列)：
+//   uint32_t tag[ways]                  line address (addr >> idx_shift)，空的格子放 NO_TAG
+//   uint64_t valid[words], dirty[words] 每個 way 一個 bit，words = (ways + 63) / 64
+//   policy 的 per-set 資料              policy_t::meta_bytes(ways) bytes
+// record 對齊並補到 64 bytes 的倍數，8 個 way 以內的 LRU / FIFO / random 一個 set 剛好一條 host cache line
+// 第一次放進 line address 在 32 bits 以上的 line 時 (例如 RV64 pk 的 stack 在 0x7ffffff000 附近)，
+// 整個 cache 換成 uint64_t tag[ways] 的 record (widen())，之後比對 tag 改用一般的迴圈
+//
+// replacement policy 的介面和各個 policy 在 cachepolicy.h
+
+#ifndef _RISCV_CACHE_CORE_H
+#define _RISCV_CACHE_CORE_H
+
+#include "cachesim.h"
+#include "cachepolicy.h"
+#include "tagmatch.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+template <template <size_t> class policy_t, size_t WAYS>
+class cache_core_t : public cache_sim_t
+{
+ public:
+  cache_core_t(size_t sets, size_t ways, size_t linesz, const char* name, cache_options_t& opts)
+    : cache_sim_t(sets, ways, linesz, name), policy(sets, ways, opts), match(select_tag_match()), wide(false)
+  {
+    stride = record_bytes();
+    records = alloc_sets(sets * stride);
+    for (size_t idx = 0; idx < sets; idx++) {
+      uint8_t* s = records + idx * stride;
+      memset(s, 0, stride);
+      for (size_t i = 0; i < nways(); i++)
+        clear_tag(s, i);
+      policy.init(meta(s), idx);
+    }
+  }
+  cache_core_t(const cache_core_t& rhs)
+    : cache_sim_t(rhs), policy(rhs.policy), match(rhs.match), wide(rhs.wide), stride(rhs.stride)
+  {
+    records = alloc_sets(sets * stride);
+    memcpy(records, rhs.records, sets * stride);
+  }
+  ~cache_core_t() { free(records); }
+
+  void access_batch(const cache_access_t* batch, size_t n)
+  {
+    access_batch_impl<cache_core_t>(batch, n);
+  }
+
+  void fill(uint64_t addr, bool dirty)
+  {
+    fill_impl<cache_core_t>(addr, dirty);
+  }
+
+  uint64_t invalidate_line(uint64_t addr, bool clean, bool inval)
+  {
+    uint8_t* s;
+    size_t way = find(addr >> idx_shift, &s);
+    if (way == nways())
+      return 0;
+    uint64_t state = VALID | (test_bit(dirty(s), way) ? DIRTY : 0);
+    if (clean && test_bit(dirty(s), way)) {
+      writebacks++;
+      clear_bit(dirty(s), way);
+    }
+    if (inval) {
+      policy.on_invalidate(meta(s), way);
+      clear_bit(valid(s), way);
+      clear_bit(dirty(s), way);
+      clear_tag(s, way);
+    }
+    return state;
+  }
+
+  bool hit(uint64_t addr, bool store)
+  {
+    uint8_t* s;
+    size_t way = find(addr >> idx_shift, &s);
+    if (way == nways())
+      return false;
+    policy.on_hit(meta(s), way);
+    if (store)
+      set_bit(dirty(s), way);
+    return true;
+  }
+
+  void set_dirty(uint64_t addr)
+  {
+    uint8_t* s;
+    size_t way = find(addr >> idx_shift, &s);
+    if (way != nways())
+      set_bit(dirty(s), way);
+  }
+
+  uint64_t victimize(uint64_t addr)
+  {
+    uint64_t line = addr >> idx_shift;
+    if (unlikely(line >= NO_TAG) && !wide)
+      widen();
+    uint8_t* s = set(line);
+    size_t way = policy.choose_victim(meta(s), valid(s));
+
+    // 回傳的 victim 跟 cache_sim_t 的 tags 一樣是 line address | VALID | DIRTY
+    uint64_t victim = 0;
+    if (test_bit(valid(s), way))
+      victim = tag(s, way) | VALID | (test_bit(dirty(s), way) ? DIRTY : 0);
+    set_tag(s, way, line);
+    set_bit(valid(s), way);
+    clear_bit(dirty(s), way);
+    policy.on_fill(meta(s), way);
+    return victim;
+  }
+
+ private:
+  // 32-bit 的 tag 空的格子放 NO_TAG，line address 是 NO_TAG 以上的要先 widen()
+  // 64-bit 的 tag 空的格子放 NO_WIDE_TAG (line address 最多 61 bits，不會撞到)
+  static const uint32_t NO_TAG = 0xffffffff;
+  static const uint64_t NO_WIDE_TAG = ~0ULL;
+
+  size_t nways() const { return WAYS ? WAYS : ways; }
+  size_t mask_words() const { return (nways() + 63) / 64; }
+  size_t tag_bytes() const { return wide ? sizeof(uint64_t) : sizeof(uint32_t); }
+  size_t mask_offset() const { return (nways() * tag_bytes() + 7) & ~size_t(7); }
+  size_t meta_offset() const { return mask_offset() + 2 * mask_words() * sizeof(uint64_t); }
+  size_t record_bytes() const { return (meta_offset() + policy_t<WAYS>::meta_bytes(nways()) + 63) & ~size_t(63); }
+
+  uint8_t* set(uint64_t line) const { return records + index_of(line) * stride; }
+  uint32_t* set_tags(uint8_t* s) const { return (uint32_t*)s; }
+  uint64_t* wide_tags(uint8_t* s) const { return (uint64_t*)s; }
+  uint64_t tag(uint8_t* s, size_t i) const { return wide ? wide_tags(s)[i] : set_tags(s)[i]; }
+  void set_tag(uint8_t* s, size_t i, uint64_t line)
+  {
+    if (wide)
+      wide_tags(s)[i] = line;
+    else
+      set_tags(s)[i] = uint32_t(line);
+  }
+  void clear_tag(uint8_t* s, size_t i) { set_tag(s, i, wide ? NO_WIDE_TAG : NO_TAG); }
+  uint64_t* valid(uint8_t* s) const { return (uint64_t*)(s + mask_offset()); }
+  uint64_t* dirty(uint8_t* s) const { return valid(s) + mask_words(); }
+  uint8_t* meta(uint8_t* s) const { return s + meta_offset(); }
+
+  // 在 line 所在的 set 裡找它，回傳 way (沒找到回傳 nways())，*sp 設成那個 set
+  size_t find(uint64_t line, uint8_t** sp)
+  {
+    uint8_t* s = *sp = set(line);
+    if (unlikely(wide)) {
+      const uint64_t* t = wide_tags(s);
+      for (size_t i = 0; i < nways(); i++)
+        if (t[i] == line)
+          return i;
+      return nways();
+    }
+    if (unlikely(line >= NO_TAG)) // 還沒 widen() 過，不可能在 cache 裡
+      return nways();
+    const uint32_t* t = set_tags(s);
+    uint32_t tag = uint32_t(line);
+
+    // 8 個 way 以上交給 SIMD kernel 一次比好幾個 way；way 少的時候展開的迴圈就夠快了
+    // WAYS 是常數的時候用可以 inline 的 kernel，執行時才知道 ways 的才經過 CPUID 挑的 match
+    // 空的格子是 NO_TAG，不會跟任何 tag 相等，所以不用再看 valid
+    if (WAYS >= 8)
+      return tag_match_inline(t, nways(), tag);
+    if (nways() >= 8)
+      return match(t, nways(), tag);
+    for (size_t i = 0; i < nways(); i++)
+      if (t[i] == tag)
+        return i;
+    return nways();
+  }
+
+  static uint8_t* alloc_sets(size_t bytes)
+  {
+    void* p;
+    if (posix_memalign(&p, 64, bytes))
+      throw std::bad_alloc();
+    return (uint8_t*)p;
+  }
+
+  // 所有 record 換成 64-bit tag 的排法，valid / dirty 和 policy 的資料照搬
+  __attribute__((noinline)) void widen()
+  {
+    size_t old_stride = stride, old_meta = meta_offset(), old_mask = mask_offset();
+    uint8_t* old = records;
+    wide = true;
+    stride = record_bytes();
+    records = alloc_sets(sets * stride);
+    for (size_t idx = 0; idx < sets; idx++) {
+      uint8_t* from = old + idx * old_stride;
+      uint8_t* s = records + idx * stride;
+      memset(s, 0, stride);
+      for (size_t i = 0; i < nways(); i++) {
+        uint32_t t = set_tags(from)[i];
+        if (t == NO_TAG)
+          clear_tag(s, i);
+        else
+          set_tag(s, i, t);
+      }
+      memcpy(valid(s), from + old_mask, old_meta - old_mask);
+      memcpy(meta(s), from + old_meta, policy_t<WAYS>::meta_bytes(nways()));
+    }
+    free(old);
+  }
+
+  policy_t<WAYS> policy;
+  tag_match_fn_t match;
+  bool wide; // tag 已經換成 64 bits 了
+  size_t stride; // 一個 set 的 record 有幾 bytes (64 的倍數)
+  uint8_t* records; // sets 筆 record，對齊 64 bytes
+};
+
+#endif
@@ -0,0 +1,543 @@
+// See LICENSE for license details.
+
+// cache_core_t 的 replacement policy，每個 policy 是一個 template class，跟 tag 的存法分開
+// cache_core_t 把每個 set 的 policy 資料放在那個 set 的 record 後面，用 meta 指標傳進來
+//
+// policy 要提供 (WAYS 是 0 代表 ways 執行時才知道)：
+//   policy_t<WAYS>(sets, ways, opts)              opts 是 config 裡的 key=value 選項，用 take_option() 拿自己的
+//   static size_t meta_bytes(size_t ways)          每個 set 要多少 bytes 的 per-set 資料
+//   void init(uint8_t* meta, size_t idx)           把第 idx 個 set 的資料清成還沒放過東西的樣子
+//   void on_hit(uint8_t* meta, size_t way)         hit 到這個 set 的第 way 格
+//   void on_fill(uint8_t* meta, size_t way)        新的 block 放進第 way 格
+//   void on_invalidate(uint8_t* meta, size_t way)  第 way 格被 clean_invalidate 清掉
+//   size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+//                                                  miss 時選要換掉哪一格，valid 是這個 set 的 valid bitmask
+
+#ifndef _RISCV_CACHE_POLICY_H
+#define _RISCV_CACHE_POLICY_H
+
+#include "cachesim.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+static inline bool test_bit(const uint64_t* m, size_t i) { return (m[i / 64] >> (i % 64)) & 1; }
+static inline void set_bit(uint64_t* m, size_t i) { m[i / 64] |= 1ULL << (i % 64); }
+static inline void clear_bit(uint64_t* m, size_t i) { m[i / 64] &= ~(1ULL << (i % 64)); }
+
+// 第一個還沒放東西的 way，都放滿了就回傳 ways
+static inline size_t first_invalid(const uint64_t* valid, size_t ways)
+{
+  for (size_t w = 0; w * 64 < ways; w++)
+    if (~valid[w]) {
+      size_t i = w * 64 + __builtin_ctzll(~valid[w]);
+      return i < ways ? i : ways;
+    }
+  return ways;
+}
+
+// rank 和 way 的編號用多寬的整數：ways 是常數而且小於 256 就用 1 byte (最大值留給 NIL)
+template <size_t WAYS>
+using way_index_t = typename std::conditional<(WAYS != 0 && WAYS < 256), uint8_t, uint16_t>::type;
+
+// 原本 spike 的 random replacement
+template <size_t WAYS>
+class random_policy_t
+{
+ public:
+  random_policy_t(size_t, size_t ways, cache_options_t&) : ways(ways) {}
+  static size_t meta_bytes(size_t UNUSED ways) { return 0; }
+  void init(uint8_t*, size_t) {}
+  void on_hit(uint8_t*, size_t) {}
+  void on_fill(uint8_t*, size_t) {}
+  void on_invalidate(uint8_t*, size_t) {}
+  size_t choose_victim(uint8_t*, const uint64_t*) { return lfsr.next() % nways(); }
+
+ private:
+  size_t nways() const { return WAYS ? WAYS : ways; }
+
+  size_t ways;
+  lfsr_t lfsr;
+};
+
+// FIFO：每個 set 記住下一個要被換掉的 way，輪流替換
+template <size_t WAYS>
+class fifo_policy_t
+{
+ public:
+  fifo_policy_t(size_t, size_t ways, cache_options_t&) : ways(ways) {}
+  static size_t meta_bytes(size_t UNUSED ways) { return sizeof(way_index_t<WAYS>); }
+  void init(uint8_t* meta, size_t UNUSED idx) { *next_way(meta) = 0; }
+  void on_hit(uint8_t*, size_t) {}
+  void on_fill(uint8_t* meta, size_t way) { *next_way(meta) = (way + 1) % nways(); }
+  void on_invalidate(uint8_t*, size_t) {}
+  size_t choose_victim(uint8_t* meta, const uint64_t*) { return *next_way(meta); }
+
+ private:
+  size_t nways() const { return WAYS ? WAYS : ways; }
+  static way_index_t<WAYS>* next_way(uint8_t* meta) { return (way_index_t<WAYS>*)meta; }
+
+  size_t ways;
+};
+
+// LRU：每個 way 記一個 rank，0 是最近用到的，ways-1 是最久沒用到的
+// 碰到一個 way 時比它新的都往後退一格，它變成 0；還沒放過東西的 way 最先被選到
+template <size_t WAYS>
+class lru_policy_t
+{
+ public:
+  lru_policy_t(size_t, size_t ways, cache_options_t&) : ways(ways) {}
+  static size_t meta_bytes(size_t ways) { return ways * sizeof(way_index_t<WAYS>); }
+  void init(uint8_t* meta, size_t UNUSED idx)
+  {
+    for (size_t i = 0; i < nways(); i++)
+      rank(meta)[i] = i;
+  }
+  void on_hit(uint8_t* meta, size_t way) { touch(meta, way); }
+  void on_fill(uint8_t* meta, size_t way) { touch(meta, way); }
+  void on_invalidate(uint8_t*, size_t) {} // 清掉的 way 沒有 valid，下次 miss 會先選到
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    size_t way = first_invalid(valid, nways());
+    if (way != nways())
+      return way;
+    const way_index_t<WAYS>* r = rank(meta);
+    for (way = 0; r[way] != nways() - 1; way++)
+      ;
+    return way;
+  }
+
+ protected:
+  size_t nways() const { return WAYS ? WAYS : ways; }
+  static way_index_t<WAYS>* rank(uint8_t* meta) { return (way_index_t<WAYS>*)meta; }
+
+  void touch(uint8_t* meta, size_t way)
+  {
+    way_index_t<WAYS>* r = rank(meta);
+    way_index_t<WAYS> old = r[way];
+    for (size_t i = 0; i < nways(); i++)
+      r[i] += r[i] < old;
+    r[way] = 0;
+  }
+
+  size_t ways;
+};
+
+// SELF：換掉最近才被用到的 block (MRU)；整條都沒放過東西時選第一個
+template <size_t WAYS>
+class mru_policy_t : public lru_policy_t<WAYS>
+{
+ public:
+  mru_policy_t(size_t sets, size_t ways, cache_options_t& opts) : lru_policy_t<WAYS>(sets, ways, opts) {}
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    const way_index_t<WAYS>* r = this->rank(meta);
+    size_t way = this->nways();
+    for (size_t i = 0; i < this->nways(); i++)
+      if (test_bit(valid, i) && (way == this->nways() || r[i] < r[way]))
+        way = i;
+    return way == this->nways() ? 0 : way;
+  }
+};
+
+// LFU：hit 次數最少的先換掉，次數一樣時換掉最久沒用到的
+// 每個 set 把 way 依照 (次數, 最後一次用到的時間) 排好，同樣次數的 way 串成一個 bucket，
+// bucket 依照次數由小到大串起來；hit 時把 way 搬到下一個 bucket (次數 + 1) 的最後面，
+// miss 時換掉第一個 bucket 最前面的 way，都是 O(1)
+// 新放進來的 block 次數是 0，不管是讀還是寫的 miss 放進來的 (寫入 miss 只設 dirty，不算 hit)
+// decay=N：一個 set 每被存取 N 次，所有次數減半 (變成一樣次數的 bucket 合併)，很久以前很熱的 block 不會一直佔著
+template <size_t WAYS>
+class lfu_policy_t
+{
+ public:
+  lfu_policy_t(size_t UNUSED sets, size_t ways, cache_options_t& opts)
+    : ways(ways), decay(take_option(opts, "decay", 0)) {}
+  static size_t meta_bytes(size_t ways) { return (1 + ways) * sizeof(uint32_t) + (7 * ways + 2) * sizeof(idx_t); }
+  void init(uint8_t* meta, size_t UNUSED idx)
+  {
+    set_t s = view(meta);
+    *s.accesses = 0;
+    *s.first = NIL;
+    *s.free = 0;
+    for (size_t i = 0; i < nways(); i++) {
+      s.bnext[i] = i + 1 < nways() ? i + 1 : NIL; // 沒用到的 bucket 用 bnext 串起來
+      s.bucket[i] = NIL;
+    }
+  }
+  void on_hit(uint8_t* meta, size_t way)
+  {
+    set_t s = view(meta);
+    idx_t b = s.bucket[way];
+    uint32_t f = s.freq[b];
+    if (f != std::numeric_limits<uint32_t>::max()) {
+      idx_t next = s.bnext[b];
+      if (s.head[b] == s.tail[b] && (next == NIL || s.freq[next] != f + 1)) {
+        s.freq[b] = f + 1; // bucket 裡只有它，直接改次數
+      } else {
+        idx_t nb = bucket_after(s, b, f + 1);
+        remove(s, way);
+        append(s, nb, way);
+      }
+    } else if (s.tail[b] != way) {
+      remove(s, way);
+      append(s, b, way);
+    }
+    age(s);
+  }
+  void on_fill(uint8_t* meta, size_t way)
+  {
+    set_t s = view(meta);
+    if (s.bucket[way] != NIL)
+      remove(s, way);
+    append(s, bucket_after(s, NIL, 0), way);
+    age(s);
+  }
+  void on_invalidate(uint8_t* meta, size_t way)
+  {
+    set_t s = view(meta);
+    if (s.bucket[way] != NIL)
+      remove(s, way);
+  }
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    size_t way = first_invalid(valid, nways());
+    if (way != nways())
+      return way;
+    set_t s = view(meta);
+    return s.head[*s.first];
+  }
+
+ private:
+  typedef way_index_t<WAYS> idx_t;
+  static const idx_t NIL = std::numeric_limits<idx_t>::max();
+
+  // 一個 set 的資料，bucket 和 way 各 ways 格
+  struct set_t
+  {
+    uint32_t* accesses; // decay 用，這個 set 被存取幾次了
+    uint32_t* freq; // bucket 的次數
+    idx_t* head; // bucket 裡最久沒用到的 way
+    idx_t* tail; // bucket 裡最近用到的 way
+    idx_t* bprev;
+    idx_t* bnext;
+    idx_t* wprev;
+    idx_t* wnext;
+    idx_t* bucket; // way 在哪個 bucket，沒放東西是 NIL
+    idx_t* first; // 次數最少的 bucket
+    idx_t* free; // 沒用到的 bucket
+  };
+
+  size_t nways() const { return WAYS ? WAYS : ways; }
+  set_t view(uint8_t* meta) const
+  {
+    size_t n = nways();
+    set_t s;
+    s.accesses = (uint32_t*)meta;
+    s.freq = s.accesses + 1;
+    s.head = (idx_t*)(s.freq + n);
+    s.tail = s.head + n;
+    s.bprev = s.tail + n;
+    s.bnext = s.bprev + n;
+    s.wprev = s.bnext + n;
+    s.wnext = s.wprev + n;
+    s.bucket = s.wnext + n;
+    s.first = s.bucket + n;
+    s.free = s.first + 1;
+    return s;
+  }
+
+  // prev 後面 (prev 是 NIL 就是最前面) 次數是 f 的 bucket，沒有的話新開一個接在 prev 後面
+  idx_t bucket_after(set_t& s, idx_t prev, uint32_t f)
+  {
+    idx_t next = prev == NIL ? *s.first : s.bnext[prev];
+    if (next != NIL && s.freq[next] == f)
+      return next;
+    idx_t b = *s.free;
+    *s.free = s.bnext[b];
+    s.freq[b] = f;
+    s.head[b] = s.tail[b] = NIL;
+    s.bprev[b] = prev;
+    s.bnext[b] = next;
+    (prev == NIL ? *s.first : s.bnext[prev]) = b;
+    if (next != NIL)
+      s.bprev[next] = b;
+    return b;
+  }
+
+  void unlink_bucket(set_t& s, idx_t b)
+  {
+    (s.bprev[b] == NIL ? *s.first : s.bnext[s.bprev[b]]) = s.bnext[b];
+    if (s.bnext[b] != NIL)
+      s.bprev[s.bnext[b]] = s.bprev[b];
+    s.bnext[b] = *s.free;
+    *s.free = b;
+  }
+
+  void remove(set_t& s, size_t way)
+  {
+    idx_t b = s.bucket[way];
+    idx_t p = s.wprev[way], n = s.wnext[way];
+    (p == NIL ? s.head[b] : s.wnext[p]) = n;
+    (n == NIL ? s.tail[b] : s.wprev[n]) = p;
+    s.bucket[way] = NIL;
+    if (s.head[b] == NIL)
+      unlink_bucket(s, b);
+  }
+
+  void append(set_t& s, idx_t b, size_t way)
+  {
+    s.bucket[way] = b;
+    s.wprev[way] = s.tail[b];
+    s.wnext[way] = NIL;
+    (s.tail[b] == NIL ? s.head[b] : s.wnext[s.tail[b]]) = way;
+    s.tail[b] = way;
+  }
+
+  void age(set_t& s)
+  {
+    if (!decay || ++*s.accesses < decay)
+      return;
+    *s.accesses = 0;
+    for (idx_t b = *s.first; b != NIL; ) {
+      idx_t next = s.bnext[b], p = s.bprev[b];
+      s.freq[b] /= 2;
+      if (p != NIL && s.freq[p] == s.freq[b]) {
+        // 跟前一個 bucket 一樣次數了，整串 way 接到它後面
+        for (idx_t w = s.head[b]; w != NIL; w = s.wnext[w])
+          s.bucket[w] = p;
+        s.wnext[s.tail[p]] = s.head[b];
+        s.wprev[s.head[b]] = s.tail[p];
+        s.tail[p] = s.tail[b];
+        unlink_bucket(s, b);
+      }
+      b = next;
+    }
+  }
+
+  size_t ways;
+  size_t decay; // 0 代表不衰減
+};
+
+// RRIP (Jaleel et al., ISCA 2010)：每個 way 一個 2-bit 的 RRPV (re-reference prediction value)
+// 0 代表很快會再被用到，RRPV_MAX 代表很久以後才會用到
+// hit 時 RRPV 清成 0；miss 時換掉第一個 RRPV_MAX 的 way，沒有的話全部加一再找
+// 一個 uint64_t 放 32 個 way 的 RRPV
+// SRRIP：新放進來的 block 是 RRPV_MAX - 1，只被用一次的 block (scan) 不會把常用的擠掉
+template <size_t WAYS>
+class srrip_policy_t
+{
+ public:
+  srrip_policy_t(size_t, size_t ways, cache_options_t&) : ways(ways) {}
+  static size_t meta_bytes(size_t ways) { return words(ways) * sizeof(uint64_t); }
+  void init(uint8_t* meta, size_t UNUSED idx)
+  {
+    for (size_t w = 0; w < words(nways()); w++)
+      rrpv(meta)[w] = lanes(w) * RRPV_MAX;
+  }
+  void on_hit(uint8_t* meta, size_t way) { set_rrpv(meta, way, 0); }
+  void on_fill(uint8_t* meta, size_t way) { set_rrpv(meta, way, RRPV_MAX - 1); }
+  void on_invalidate(uint8_t* meta, size_t way) { set_rrpv(meta, way, RRPV_MAX); }
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    size_t way = first_invalid(valid, nways());
+    if (way != nways())
+      return way;
+
+    // 最多加 RRPV_MAX 次就一定有 way 是 RRPV_MAX；2-bit 的欄位都還沒滿，整個 word 一起加不會進位
+    uint64_t* r = rrpv(meta);
+    for (;;) {
+      for (size_t w = 0; w < words(nways()); w++) {
+        uint64_t max = r[w] & (r[w] >> 1) & lanes(w);
+        if (max)
+          return w * 32 + __builtin_ctzll(max) / 2;
+      }
+      for (size_t w = 0; w < words(nways()); w++)
+        r[w] += lanes(w);
+    }
+  }
+
+ protected:
+  static const uint64_t RRPV_MAX = 3;
+  static const uint64_t LANE_LSB = 0x5555555555555555ULL; // 每個 2-bit 欄位的最低位
+
+  size_t nways() const { return WAYS ? WAYS : ways; }
+  static size_t words(size_t ways) { return (ways + 31) / 32; }
+  static uint64_t* rrpv(uint8_t* meta) { return (uint64_t*)meta; }
+
+  // 第 w 個 word 裡真的有 way 的欄位，每個欄位的最低位是 1
+  uint64_t lanes(size_t w) const
+  {
+    size_t n = nways() - w * 32;
+    return n >= 32 ? LANE_LSB : LANE_LSB & ((1ULL << (2 * n)) - 1);
+  }
+
+  static void set_rrpv(uint8_t* meta, size_t way, uint64_t v)
+  {
+    uint64_t& r = rrpv(meta)[way / 32];
+    size_t shift = 2 * (way % 32);
+    r = (r & ~(RRPV_MAX << shift)) | (v << shift);
+  }
+
+  size_t ways;
+};
+
+// BRRIP：新放進來的 block 大多是 RRPV_MAX，每 BIMODAL_PERIOD 次才有一次是 RRPV_MAX - 1
+// working set 比 cache 大的時候 (thrashing) 至少還能留住一部分
+template <size_t WAYS>
+class brrip_policy_t : public srrip_policy_t<WAYS>
+{
+ public:
+  brrip_policy_t(size_t sets, size_t ways, cache_options_t& opts) : srrip_policy_t<WAYS>(sets, ways, opts), fills(0) {}
+  void on_fill(uint8_t* meta, size_t way) { this->set_rrpv(meta, way, bimodal_rrpv()); }
+
+ protected:
+  static const unsigned BIMODAL_PERIOD = 32;
+
+  uint64_t bimodal_rrpv()
+  {
+    return fills++ % BIMODAL_PERIOD == 0 ? this->RRPV_MAX - 1 : this->RRPV_MAX;
+  }
+
+  uint64_t fills;
+};
+
+// DRRIP：set dueling，每 DUEL_PERIOD 個 set 拿第一個固定用 SRRIP、最後一個固定用 BRRIP
+// 兩種 leader set 的 miss 用 PSEL (10-bit saturating counter) 比輸贏，其他的 set 跟著 miss 比較少的那種放
+// 每個 set 多一個 byte 記它是哪一種 leader
+template <size_t WAYS>
+class drrip_policy_t : public brrip_policy_t<WAYS>
+{
+ public:
+  drrip_policy_t(size_t sets, size_t ways, cache_options_t& opts)
+    : brrip_policy_t<WAYS>(sets, ways, opts), period(sets < DUEL_PERIOD ? sets : DUEL_PERIOD), psel(PSEL_MAX / 2) {}
+  static size_t meta_bytes(size_t ways) { return srrip_policy_t<WAYS>::meta_bytes(ways) + 1; }
+  void init(uint8_t* meta, size_t idx)
+  {
+    srrip_policy_t<WAYS>::init(meta, idx);
+    *leader(meta) = idx % period == 0 ? SRRIP_LEADER : idx % period == period - 1 ? BRRIP_LEADER : FOLLOWER;
+  }
+  void on_fill(uint8_t* meta, size_t way)
+  {
+    bool brrip = *leader(meta) == FOLLOWER ? psel > PSEL_MAX / 2 : *leader(meta) == BRRIP_LEADER;
+    this->set_rrpv(meta, way, brrip ? this->bimodal_rrpv() : this->RRPV_MAX - 1);
+  }
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    // 每次 miss 都會來這裡選 victim，順便記下是哪種 leader set miss 了
+    if (*leader(meta) == SRRIP_LEADER && psel < PSEL_MAX)
+      psel++;
+    else if (*leader(meta) == BRRIP_LEADER && psel > 0)
+      psel--;
+    return srrip_policy_t<WAYS>::choose_victim(meta, valid);
+  }
+
+ private:
+  static const size_t DUEL_PERIOD = 32;
+  static const unsigned PSEL_MAX = 1023;
+  enum { FOLLOWER, SRRIP_LEADER, BRRIP_LEADER };
+
+  uint8_t* leader(uint8_t* meta) const { return meta + srrip_policy_t<WAYS>::meta_bytes(this->nways()); }
+
+  size_t period;
+  unsigned psel; // SRRIP 的 leader set miss 比較多就往上加，超過一半時 follower 用 BRRIP
+};
+
+// tree-PLRU：ways 當成一棵二元樹的葉子，每個內部節點 1 個 bit 指向比較久沒用到的那一邊 (0 左 1 右)
+// 一個 set 只要 ways - 1 個 bits；碰到一個 way 時把路上的節點都指向另一邊，miss 時順著 bit 走到葉子
+// ways 不是 2 的次方時樹補滿到 2 的次方，走到沒有 way 的那一邊時改走左邊
+// 節點用 heap 的編號 (根是 1，node 的小孩是 2 * node 和 2 * node + 1)
+template <size_t WAYS>
+class tree_plru_policy_t
+{
+ public:
+  tree_plru_policy_t(size_t, size_t ways, cache_options_t&) : ways(ways), nleaves(leaves(ways)) {}
+  static size_t meta_bytes(size_t ways) { return (leaves(ways) + 63) / 64 * sizeof(uint64_t); }
+  void init(uint8_t* meta, size_t UNUSED idx) { memset(meta, 0, meta_bytes(nways())); }
+  void on_hit(uint8_t* meta, size_t way) { touch(meta, way); }
+  void on_fill(uint8_t* meta, size_t way) { touch(meta, way); }
+  void on_invalidate(uint8_t*, size_t) {}
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    size_t way = first_invalid(valid, nways());
+    if (way != nways())
+      return way;
+
+    const uint64_t* bits = (const uint64_t*)meta;
+    size_t node = 1, lo = 0;
+    for (size_t span = nleaves / 2; span; span /= 2) {
+      bool right = test_bit(bits, node) && lo + span < nways();
+      lo += right ? span : 0;
+      node = 2 * node + right;
+    }
+    return lo;
+  }
+
+ private:
+  size_t nways() const { return WAYS ? WAYS : ways; }
+  static size_t leaves(size_t ways)
+  {
+    size_t n = 1;
+    while (n < ways)
+      n *= 2;
+    return n;
+  }
+
+  void touch(uint8_t* meta, size_t way)
+  {
+    uint64_t* bits = (uint64_t*)meta;
+    size_t node = 1, lo = 0;
+    for (size_t span = nleaves / 2; span; span /= 2) {
+      bool right = way >= lo + span;
+      if (right) {
+        clear_bit(bits, node);
+        lo += span;
+      } else {
+        set_bit(bits, node);
+      }
+      node = 2 * node + right;
+    }
+  }
+
+  size_t ways;
+  size_t nleaves; // 補到 2 的次方的葉子數
+};
+
+// bit-PLRU (MRU bits)：每個 way 1 個 bit，被碰到就設起來；全部都設起來時只留下剛碰到的那個
+// miss 時換掉第一個 bit 是 0 的 way
+template <size_t WAYS>
+class bit_plru_policy_t
+{
+ public:
+  bit_plru_policy_t(size_t, size_t ways, cache_options_t&) : ways(ways) {}
+  static size_t meta_bytes(size_t ways) { return (ways + 63) / 64 * sizeof(uint64_t); }
+  void init(uint8_t* meta, size_t UNUSED idx) { memset(meta, 0, meta_bytes(nways())); }
+  void on_hit(uint8_t* meta, size_t way) { touch(meta, way); }
+  void on_fill(uint8_t* meta, size_t way) { touch(meta, way); }
+  void on_invalidate(uint8_t* meta, size_t way) { clear_bit((uint64_t*)meta, way); }
+  size_t choose_victim(uint8_t* meta, const uint64_t* valid)
+  {
+    size_t way = first_invalid(valid, nways());
+    if (way != nways())
+      return way;
+    way = first_invalid((const uint64_t*)meta, nways());
+    return way == nways() ? 0 : way; // 只有 1 個 way 時 bit 永遠是 1
+  }
+
+ private:
+  size_t nways() const { return WAYS ? WAYS : ways; }
+
+  void touch(uint8_t* meta, size_t way)
+  {
+    uint64_t* mru = (uint64_t*)meta;
+    set_bit(mru, way);
+    if (first_invalid(mru, nways()) == nways()) {
+      memset(mru, 0, meta_bytes(nways()));
+      set_bit(mru, way);
+    }
+  }
+
+  size_t ways;
+};
+
+#endif
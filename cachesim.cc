@@ -0,0 +1,1331 @@
+// See LICENSE for license details.
+
+#include "cachesim.h"
+#include "cachecore.h"
+#include "prefetch.h"
+#include "stackdist.h"
+#include "interval.h"
+#include "common.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+// Constructor for cache_sim_t
+// parameters : sets, ways, linesz(block size / line size), name
+cache_sim_t::cache_sim_t(size_t _sets, size_t _ways, size_t _linesz, const char* _name)
+: sets(_sets), ways(_ways), linesz(_linesz), name(_name), log(false) //The sets, ways, and linesz members are initialized with the values of the _sets, _ways, and _linesz parameters, respectively. The name member is initialized with the value of the _name parameter. The log member is initialized with false.
+{
+  init(); // initializes the rest of the object
+}
+
+// error message & exit(1)
+// handle when encounter wrong input
+static void help()
+{
+  std::cerr << "Cache configurations must be of the form" << std::endl;
+  std::cerr << "  sets:ways:blocksize[:policy][:key=value]..." << std::endl;
+  std::cerr << "where sets, ways, and blocksize are positive integers, with" << std::endl;
+  std::cerr << "sets and blocksize both powers of two and blocksize at least 8." << std::endl;
+  std::cerr << "policy is one of origin (random, default), fifo, lru, lfu, self," << std::endl;
+  std::cerr << "srrip, brrip, drrip, plru (tree pseudo-LRU), bitplru (MRU-bit pseudo-LRU)," << std::endl;
+  std::cerr << "arc (fully-associative only, sets must be 1)." << std::endl;
+  std::cerr << "options:" << std::endl;
+  std::cerr << "  decay=N  lfu: halve a set's use counts every N accesses to it" << std::endl;
+  std::cerr << "  incl=M   inclusion of the levels above this one (the caches using it as" << std::endl;
+  std::cerr << "           their miss handler): nine (default), inclusive, exclusive" << std::endl;
+  std::cerr << "  vc=N     put an N-block fully-associative LRU victim cache behind this cache" << std::endl;
+  std::cerr << "  pf=P     hardware prefetcher: next (next-line), stride (per 4 KB region)," << std::endl;
+  std::cerr << "           stream (stream buffers)" << std::endl;
+  std::cerr << "  pfdegree=N  next / stride: lines fetched ahead per trigger (default 1)" << std::endl;
+  std::cerr << "  pfdepth=N   stream: lines kept ahead of each stream (default 4)" << std::endl;
+  std::cerr << "  3c=1     classify misses as compulsory, capacity or conflict" << std::endl;
+  std::cerr << "  rd=N     print a log2 histogram of reuse distances (in lines); N > 1 samples" << std::endl;
+  std::cerr << "           1/N of the lines and scales the result (SHARDS)" << std::endl;
+  std::cerr << "  interval=N  write the counters every N accesses to <name>.intervals.csv" << std::endl;
+  std::cerr << "  heatmap=1   write per-set accesses, misses and dirty evictions to <name>.sets.csv" << std::endl;
+  std::cerr << "  index=F  set index function: mod (default), xor (fold the upper line bits)," << std::endl;
+  std::cerr << "           prime (modulo the largest prime <= sets), skew (a different hash per" << std::endl;
+  std::cerr << "           way; policy must be origin, fifo or lru)" << std::endl;
+  exit(1);
+}
+
+// 依照 ways 選一個 cache_core_t，常見的 ways 直接當成 template 常數，比對 tag 的迴圈會被展開
+template <template <size_t> class policy_t>
+static cache_sim_t* make_core(size_t sets, size_t ways, size_t linesz, const char* name, cache_options_t& opts)
+{
+  if (ways == 0 || ways > 65535) // way 的編號最多 16 bits，0xffff 留給 NIL
+    help();
+  switch (ways) {
+    case 1: return new cache_core_t<policy_t, 1>(sets, ways, linesz, name, opts);
+    case 2: return new cache_core_t<policy_t, 2>(sets, ways, linesz, name, opts);
+    case 4: return new cache_core_t<policy_t, 4>(sets, ways, linesz, name, opts);
+    case 8: return new cache_core_t<policy_t, 8>(sets, ways, linesz, name, opts);
+    case 16: return new cache_core_t<policy_t, 16>(sets, ways, linesz, name, opts);
+    default: return new cache_core_t<policy_t, 0>(sets, ways, linesz, name, opts);
+  }
+}
+
+static cache_sim_t* make_cache(size_t sets, size_t ways, size_t linesz, const std::string& policy,
+                               const char* name, cache_options_t& opts);
+
+// 拿出選項 key 的數字 (從 opts 拿掉)，沒寫就是 def
+size_t take_option(cache_options_t& opts, const char* key, size_t def)
+{
+  auto it = opts.find(key);
+  if (it == opts.end())
+    return def;
+  char* end;
+  size_t value = strtoul(it->second.c_str(), &end, 0);
+  if (it->second.empty() || *end)
+    help();
+  opts.erase(it);
+  return value;
+}
+
+// 
+cache_sim_t* cache_sim_t::construct(const char* config, const char* name)
+{
+  // config = "sets:ways:blocksize"
+  const char* wp = strchr(config, ':');
+  if (!wp++) help(); 
+  // if(!wp) help(); 如果沒有第一個 ':' 則 print error msg & exit(1)
+  // wp++; wp 指向 ways 的位置
+  const char* bp = strchr(wp, ':');
+  if (!bp++) help();
+  // if(!bp) help(); 如果沒有第二個 ':' 則 print error msg & exit(1)
+  // bp++;  bp 指向 blocksize 的位置
+
+  // 把 "sets:ways:blocksize" 分出來三個數字
+  size_t sets = atoi(std::string(config, wp).c_str());
+  size_t ways = atoi(std::string(wp, bp).c_str());
+  size_t linesz = atoi(bp);
+
+  // 第四個欄位是 replacement policy，沒寫就是原本 spike 的 random
+  // 再後面是用 ':' 隔開的 key=value 選項
+  std::string policy = "origin";
+  cache_options_t opts;
+  bool first = true;
+  for (const char* fp = strchr(bp, ':'); fp; first = false) {
+    const char* end = strchr(++fp, ':');
+    std::string field = end ? std::string(fp, end) : std::string(fp);
+    size_t eq = field.find('=');
+    if (eq != std::string::npos)
+      opts[field.substr(0, eq)] = field.substr(eq + 1);
+    else if (first)
+      policy = field;
+    else
+      help();
+    fp = end;
+  }
+
+  // index=skew 的 set 不是一筆 record，要另外一種 cache；其他的 index function 建好之後再換
+  index_fn_t index_fn = INDEX_MOD;
+  auto index = opts.find("index");
+  if (index != opts.end()) {
+    if (index->second == "xor")
+      index_fn = INDEX_XOR;
+    else if (index->second == "prime")
+      index_fn = INDEX_PRIME;
+    else if (index->second == "skew")
+      index_fn = INDEX_SKEW;
+    else if (index->second != "mod")
+      help();
+    opts.erase(index);
+  }
+
+  cache_sim_t* cache;
+  if (index_fn == INDEX_SKEW) {
+    if (policy == "origin")
+      cache = new skew_cache_sim_t(sets, ways, linesz, name, skew_cache_sim_t::RANDOM);
+    else if (policy == "fifo")
+      cache = new skew_cache_sim_t(sets, ways, linesz, name, skew_cache_sim_t::FIFO);
+    else if (policy == "lru")
+      cache = new skew_cache_sim_t(sets, ways, linesz, name, skew_cache_sim_t::LRU);
+    else
+      help();
+  } else {
+    cache = make_cache(sets, ways, linesz, policy, name, opts);
+  }
+  cache->index_fn = index_fn;
+  auto incl = opts.find("incl");
+  if (incl != opts.end()) {
+    if (incl->second == "inclusive")
+      cache->inclusion = INCLUSIVE;
+    else if (incl->second == "exclusive")
+      cache->inclusion = EXCLUSIVE;
+    else if (incl->second != "nine")
+      help();
+    opts.erase(incl);
+  }
+  if (size_t vc = take_option(opts, "vc", 0))
+    cache->victim_cache = new fa_cache_sim_t(vc, linesz, (cache->name + " VC").c_str(), fa_cache_sim_t::LRU);
+  auto pf = opts.find("pf");
+  if (pf != opts.end()) {
+    std::string kind = pf->second;
+    opts.erase(pf);
+    if (kind == "next")
+      cache->prefetcher = new next_line_prefetcher_t(opts, cache->idx_shift);
+    else if (kind == "stride")
+      cache->prefetcher = new stride_prefetcher_t(opts, cache->idx_shift);
+    else if (kind == "stream")
+      cache->prefetcher = new stream_prefetcher_t(opts, cache->idx_shift);
+    else
+      help();
+  }
+  if (take_option(opts, "3c", 0))
+    cache->shadow = new fa_cache_sim_t(sets * ways, linesz, (cache->name + " 3C").c_str(), fa_cache_sim_t::LRU);
+  if (size_t rd = take_option(opts, "rd", 0))
+    cache->reuse = new reuse_profiler_t(rd);
+  if (size_t interval = take_option(opts, "interval", 0)) {
+    cache->intervals = new interval_log_t(cache->name);
+    cache->interval = cache->interval_left = interval;
+  }
+  if (take_option(opts, "heatmap", 0)) {
+    cache->set_stats.resize(sets);
+    cache->heatmap_path = cache_stats_path(cache->name, ".sets.csv");
+  }
+  if (!opts.empty()) {
+    std::cerr << "unknown cache option " << opts.begin()->first << std::endl;
+    help();
+  }
+  return cache;
+}
+
+// 依照 policy 建立 cache，policy 用得到的選項會從 opts 拿掉
+static cache_sim_t* make_cache(size_t sets, size_t ways, size_t linesz, const std::string& policy,
+                               const char* name, cache_options_t& opts)
+{
+  // ways 多的 fully-associative cache 用 hash table + list，找 line 和選 victim 都是 O(1)
+  bool fa = ways > 4 /* empirical */ && sets == 1;
+
+  if (policy == "fifo")
+    return fa ? new fa_cache_sim_t(ways, linesz, name, fa_cache_sim_t::FIFO) : make_core<fifo_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "lru")
+    return fa ? new fa_cache_sim_t(ways, linesz, name, fa_cache_sim_t::LRU) : make_core<lru_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "arc") {
+    if (sets != 1)
+      help();
+    return new fa_cache_sim_t(ways, linesz, name, fa_cache_sim_t::ARC);
+  }
+  if (policy == "lfu")
+    return make_core<lfu_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "self")
+    return make_core<mru_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "srrip")
+    return make_core<srrip_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "brrip")
+    return make_core<brrip_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "drrip")
+    return make_core<drrip_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "plru")
+    return make_core<tree_plru_policy_t>(sets, ways, linesz, name, opts);
+  if (policy == "bitplru")
+    return make_core<bit_plru_policy_t>(sets, ways, linesz, name, opts);
+  if (policy != "origin")
+    help();
+
+  if (fa)  // 經驗上來看，如果 ways > 4 且 sets = 1 則 return new fully-associative caches
+    return new fa_cache_sim_t(ways, linesz, name);
+  return make_core<random_policy_t>(sets, ways, linesz, name, opts); // else return new 正常的 cache
+}
+
+// log2(x)，x 是 2 的次方
+static size_t idx_shift_of(size_t x)
+{
+  size_t n = 0;
+  for (; x > 1; x >>= 1)
+    n++;
+  return n;
+}
+
+// 不超過 n 的最大質數 (n 是 1 就是 1)
+static size_t largest_prime(size_t n)
+{
+  for (; n > 2; n--) {
+    bool prime = true;
+    for (size_t d = 2; d * d <= n && prime; d++)
+      prime = n % d != 0;
+    if (prime)
+      return n;
+  }
+  return n;
+}
+
+// 初始化函數，檢查 sets 和 linesz 是否符合規定，並初始化其他成員變數
+void cache_sim_t::init()
+{
+  if (sets == 0 || (sets & (sets-1))) // if sets = 0 or sets is a power of two, then print error message & exit(1)
+    help();
+  if (linesz < 8 || (linesz & (linesz-1))) // if linesz < 8 or linesz is a power of two, then print error message & exit(1)
+    help();
+
+  idx_shift = 0;
+  for (size_t x = linesz; x>1; x >>= 1) // idx_shift = log2(linesz)
+    idx_shift++;
+
+  // 一個 entry 有 ways 個 block，總共有 sets 個 entries，所以 tags 有 sets*ways 格
+  // cache_core_t 和 fa_cache_sim_t 有自己的存法用不到 tags，等到 victimize() 第一次放東西時才配置
+  tags = NULL;
+  read_accesses = 0; 
+  read_misses = 0;
+  bytes_read = 0;
+  write_accesses = 0;
+  write_misses = 0;
+  bytes_written = 0;
+  writebacks = 0;
+  back_invalidations = 0;
+  victim_fills = 0;
+  swap_hits = 0;
+  pf_issued = 0;
+  pf_useful = 0;
+  pf_pollution = 0;
+  memset(class_misses, 0, sizeof(class_misses));
+
+  miss_handler = NULL;
+  inclusion = NINE;
+  index_fn = INDEX_MOD;
+  index_bits = idx_shift_of(sets);
+  prime_sets = largest_prime(sets);
+  victim_cache = NULL;
+  prefetcher = NULL;
+  shadow = NULL;
+  miss_class = COMPULSORY;
+  reuse = NULL;
+  intervals = NULL;
+  interval = interval_left = ~0ULL;
+}
+
+// copy constructor
+// 複製 rhs 物件的所有成員變數，並複製 tags 陣列
+cache_sim_t::cache_sim_t(const cache_sim_t& rhs)
+ : sets(rhs.sets), ways(rhs.ways), linesz(rhs.linesz),
+   idx_shift(rhs.idx_shift), name(rhs.name), log(false)
+{
+  miss_handler = NULL;
+  inclusion = rhs.inclusion;
+  index_fn = rhs.index_fn;
+  index_bits = rhs.index_bits;
+  prime_sets = rhs.prime_sets;
+  read_accesses = read_misses = bytes_read = 0;
+  write_accesses = write_misses = bytes_written = 0;
+  writebacks = back_invalidations = victim_fills = swap_hits = 0;
+  pf_issued = pf_useful = pf_pollution = 0;
+  victim_cache = rhs.victim_cache ? new fa_cache_sim_t(*rhs.victim_cache) : NULL;
+  prefetcher = NULL; // prefetcher 的訓練狀態不複製
+  memset(class_misses, 0, sizeof(class_misses));
+  shadow = rhs.shadow ? new fa_cache_sim_t(*rhs.shadow) : NULL;
+  seen = rhs.seen;
+  miss_class = rhs.miss_class;
+  reuse = rhs.reuse ? new reuse_profiler_t(*rhs.reuse) : NULL;
+  intervals = NULL; // 複製出來的不寫 interval
+  interval = interval_left = ~0ULL;
+  tags = NULL;
+  if (rhs.tags) {
+    tags = new uint64_t[sets*ways];
+    memcpy(tags, rhs.tags, sets*ways*sizeof(uint64_t));
+  }
+}
+
+// 解構子，印出統計資料並釋放 tags 陣列的記憶體
+cache_sim_t::~cache_sim_t()
+{
+  // 最後不滿 N 次的那一段也記一筆
+  if (intervals && interval_left != interval)
+    snapshot();
+  delete intervals;
+  if (!set_stats.empty())
+    write_heatmap();
+  print_stats();
+  delete victim_cache;
+  delete prefetcher;
+  delete shadow;
+  delete reuse;
+  delete [] tags;
+}
+
+// 印出統計資料的函數
+void cache_sim_t::print_stats()
+{
+  // 如果讀取和寫入的次數都為 0，則不印出任何資訊並直接返回
+  if (read_accesses + write_accesses == 0)
+    return;
+
+  // 計算 miss rate，即 cache miss 的次數除以 cache 存取的總次數，並轉換為百分比
+  float mr = 100.0f*(read_misses+write_misses)/(read_accesses+write_accesses);
+
+   // 設定輸出的精度為小數點後三位，並固定輸出小數點
+  std::cout << std::setprecision(3) << std::fixed;
+
+  // 印出各項統計資訊
+  std::cout << name << " ";
+  std::cout << "Bytes Read:            " << bytes_read << std::endl;
+  std::cout << name << " ";
+  std::cout << "Bytes Written:         " << bytes_written << std::endl;
+  std::cout << name << " ";
+  std::cout << "Read Accesses:         " << read_accesses << std::endl;
+  std::cout << name << " ";
+  std::cout << "Write Accesses:        " << write_accesses << std::endl;
+  std::cout << name << " ";
+  std::cout << "Read Misses:           " << read_misses << std::endl;
+  std::cout << name << " ";
+  std::cout << "Write Misses:          " << write_misses << std::endl;
+  std::cout << name << " ";
+  std::cout << "Writebacks:            " << writebacks << std::endl;
+  // 只有用到 incl= 才印，原本的輸出格式不變
+  if (back_invalidations) {
+    std::cout << name << " ";
+    std::cout << "Back-invalidations:    " << back_invalidations << std::endl;
+  }
+  if (inclusion == EXCLUSIVE) {
+    std::cout << name << " ";
+    std::cout << "Victim Fills:          " << victim_fills << std::endl;
+  }
+  if (victim_cache) {
+    std::cout << name << " ";
+    std::cout << "Swap Hits:             " << swap_hits << std::endl;
+  }
+  if (prefetcher) {
+    // accuracy = 用到的 / 抓進來的，coverage = 用到的 / (用到的 + 剩下的 demand miss)
+    uint64_t demand_misses = read_misses + write_misses;
+    std::cout << name << " ";
+    std::cout << "Prefetches:            " << pf_issued << std::endl;
+    std::cout << name << " ";
+    std::cout << "Useful Prefetches:     " << pf_useful << std::endl;
+    std::cout << name << " ";
+    std::cout << "Prefetch Accuracy:     " << (pf_issued ? 100.0f*pf_useful/pf_issued : 0) << '%' << std::endl;
+    std::cout << name << " ";
+    std::cout << "Prefetch Coverage:     " << (pf_useful ? 100.0f*pf_useful/(pf_useful+demand_misses) : 0) << '%' << std::endl;
+    std::cout << name << " ";
+    std::cout << "Prefetch Pollution:    " << pf_pollution << std::endl;
+  }
+  if (shadow) {
+    std::cout << name << " ";
+    std::cout << "Compulsory Misses:     " << class_misses[COMPULSORY] << std::endl;
+    std::cout << name << " ";
+    std::cout << "Capacity Misses:       " << class_misses[CAPACITY] << std::endl;
+    std::cout << name << " ";
+    std::cout << "Conflict Misses:       " << class_misses[CONFLICT] << std::endl;
+  }
+  if (reuse) {
+    // 每個 bucket 一行：距離 0、1、2-3、4-7 ...，沒有存取的 bucket 不印，最後是第一次用到的 line
+    const std::vector<uint64_t>& hist = reuse->histogram();
+    for (size_t b = 0; b < hist.size(); b++) {
+      if (!hist[b])
+        continue;
+      std::string label = b < 2 ? std::to_string(b) :
+        std::to_string(1ULL << (b-1)) + "-" + std::to_string((1ULL << (b-1)) * 2 - 1);
+      std::cout << name << " ";
+      std::cout << std::left << std::setw(23) << "Reuse Dist " + label + ":" << std::right
+                << hist[b] * reuse->scale() << std::endl;
+    }
+    std::cout << name << " ";
+    std::cout << "Reuse Dist cold:       " << reuse->cold() * reuse->scale() << std::endl;
+  }
+  if (!set_stats.empty()) {
+    // miss 最多的 set 和它佔全部 miss 的比例，整張表在 <name>.sets.csv
+    size_t hot = 0;
+    for (size_t i = 1; i < set_stats.size(); i++)
+      if (set_stats[i].misses > set_stats[hot].misses)
+        hot = i;
+    uint64_t misses = read_misses + write_misses;
+    std::cout << name << " ";
+    std::cout << "Hottest Set:           " << hot << " ("
+              << (misses ? 100.0f*set_stats[hot].misses/misses : 0) << "% of misses)" << std::endl;
+  }
+  std::cout << name << " ";
+  std::cout << "Miss Rate:             " << mr << '%' << std::endl;
+}
+
+// 檢查 tags 是否一樣
+// parameter : addr 要訪問的記憶體地址
+uint64_t* cache_sim_t::check_tag(uint64_t addr)
+{
+  // Address 是由 | tag | index | offset | 組成
+
+  // 透過 bitwise operator 萃取出 index
+  // addr >> idx_shift 是透過右移將 offset 去除
+  // AND (sets-1) 留下 index 的 bits (config 有 index= 的話改用 hash_index)
+  size_t idx = set_index(addr);
+
+  // 透過 bitwise operator 萃取出 | 1 | tag | index | 我還不知道為什麼
+  // addr >> idx_shift 是透過右移將 offset 去除
+  // OR VALID, VALID = 二進位 10000000000000000000000000000000000000000000000000000000000000000000000 
+  size_t tag = (addr >> idx_shift) | VALID;
+
+  // tags 還沒配置就是還沒放過東西
+  if (tags == NULL)
+    return NULL;
+
+  // 對於每一種方式（ways），檢查是否有標籤匹配。如果有，則返回該標籤的指針。 這邊我真的開始看不懂了
+  for (size_t i = 0; i < ways; i++)
+    if (tag == (tags[idx*ways + i] & ~DIRTY))
+      return &tags[idx*ways + i];
+  // 如果沒有找到匹配的標籤，則返回 NULL。
+  return NULL;
+}
+
+
+uint64_t cache_sim_t::victimize(uint64_t addr)
+{
+  // 計算 cache 的 index，與 check_tag 函數中的計算方式相同。
+  size_t idx = set_index(addr);
+  if (tags == NULL)
+    tags = new uint64_t[sets*ways]();
+  // 使用線性反饋移位暫存器（LFSR）生成一個隨機的方式（way）。
+  size_t way = lfsr.next() % ways;
+  // 取出被選中的 cache 線（即受害者）的標籤。
+  uint64_t victim = tags[idx*ways + way];
+  // 取出被選中的 cache 線（即受害者）的標籤。
+  tags[idx*ways + way] = (addr >> idx_shift) | VALID;
+  // 返回受害者的標籤。
+  return victim;
+}
+
+bool cache_sim_t::hit(uint64_t addr, bool store)
+{
+  uint64_t* hit_way = cache_sim_t::check_tag(addr);
+  if (hit_way == NULL)
+    return false;
+  if (store)
+    *hit_way |= DIRTY;
+  return true;
+}
+
+void cache_sim_t::set_dirty(uint64_t addr)
+{
+  if (uint64_t* t = cache_sim_t::check_tag(addr))
+    *t |= DIRTY;
+}
+
+// cache_t 是實際的 class，用 cache_t:: 直接呼叫 hit()，整個迴圈裡不用經過 virtual
+// 存取次數 / bytes 先記在區域變數，整批做完再加回去
+template <class cache_t>
+void cache_sim_t::access_batch_impl(const cache_access_t* batch, size_t n)
+{
+  cache_t* self = static_cast<cache_t*>(this);
+  uint64_t reads = 0, writes = 0, read_bytes = 0, write_bytes = 0;
+
+  for (const cache_access_t* a = batch; a != batch + n; a++) {
+    // 根據訪問類型（讀取或寫入），增加相應的訪問計數和字節數。
+    if (a->store) {
+      writes++;
+      write_bytes += a->bytes;
+    } else {
+      reads++;
+      read_bytes += a->bytes;
+    }
+
+    if (unlikely(!set_stats.empty()))
+      set_stats[set_index(a->addr)].accesses++;
+    // 3C 的 shadow 要看到每一次 demand 存取 (hit 也要更新 LRU)
+    if (unlikely(shadow != NULL))
+      shadow_access(a->addr);
+    if (unlikely(reuse != NULL))
+      reuse->access(a->addr >> idx_shift);
+
+    // 檢查該地址是否在 cache 中。
+    // 如果該地址在 cache 中（即 cache hit），hit() 會在寫入時設置 dirty 位，然後處理下一筆。
+    if (likely(self->cache_t::hit(a->addr, a->store))) {
+      if (unlikely(prefetcher != NULL))
+        prefetch_impl<cache_t>(a->addr, false);
+    } else {
+      access_miss<cache_t>(a->addr, a->store);
+    }
+
+    // 沒有 interval=N 的話從 2^64 開始倒數，不會數到 0
+    if (unlikely(--interval_left == 0)) {
+      read_accesses += reads;
+      write_accesses += writes;
+      bytes_read += read_bytes;
+      bytes_written += write_bytes;
+      reads = writes = read_bytes = write_bytes = 0;
+      snapshot();
+    }
+  }
+
+  read_accesses += reads;
+  write_accesses += writes;
+  bytes_read += read_bytes;
+  bytes_written += write_bytes;
+}
+
+template <class cache_t>
+void cache_sim_t::access_miss(uint64_t addr, bool store)
+{
+  cache_t* self = static_cast<cache_t*>(this);
+
+  // 有 victim cache 的話先在裡面找：找到就跟這次換掉的 line 對調，不算 miss，也不用去下一級
+  if (victim_cache) {
+    uint64_t state = victim_cache->invalidate_line(addr, false, true);
+    if (state & VALID) {
+      swap_hits++;
+      uint64_t victim = self->cache_t::victimize(addr);
+      note_victim(addr, victim, false);
+      evict(victim_cache_insert(victim));
+      if (store || (state & DIRTY))
+        self->cache_t::set_dirty(addr);
+      if (prefetcher)
+        prefetch_impl<cache_t>(addr, false);
+      return;
+    }
+  }
+
+  // 如果該地址不在 cache 中（即 cache 未命中），則根據訪問類型（讀取或寫入），增加相應的未命中計數。
+  store ? write_misses++ : read_misses++;
+  if (shadow)
+    class_misses[miss_class]++;
+  if (!set_stats.empty())
+    set_stats[set_index(addr)].misses++;
+  // 如果啟用了日誌，則輸出未命中的訊息。
+  if (log)
+  {
+    std::cerr << name << " "
+              << (store ? "write" : "read") << " miss 0x"
+              << std::hex << addr << std::endl;
+  }
+
+  // 如果 cache 未命中，則選擇一個受害者來替換，有 victim cache 的話受害者先放進去，改成從裡面擠出來的
+  uint64_t victim = self->cache_t::victimize(addr);
+  note_victim(addr, victim, false);
+  victim = victim_cache_insert(victim);
+
+  // 受害者交給下一級 cache 或主記憶體，再從下一級讀取新的資料
+  // 下一級是 EXCLUSIVE 的話先讀：line 要先從下一級搬上來，不然可能被放進去的受害者擠掉
+  bool exclusive = miss_handler && miss_handler->inclusion == EXCLUSIVE;
+  if (!exclusive)
+    evict(victim);
+  bool dirty = miss_handler && miss_handler->fetch(addr & ~(linesz-1), linesz);
+  if (exclusive)
+    evict(victim);
+
+  // 如果是寫入操作 (或搬上來的是 dirty 的 line)，則設置新資料的 dirty 位。
+  // 不能走 hit()：放進來的這次存取不算 reuse，RRIP / LFU / ARC 的狀態要跟讀取 miss 一樣
+  if (store || dirty)
+    self->cache_t::set_dirty(addr);
+
+  if (prefetcher)
+    prefetch_impl<cache_t>(addr, true);
+}
+
+// prefetch 的 line 跟 demand miss 一樣換掉一條 line、從下一級讀進來，只是不算存取次數
+template <class cache_t>
+void cache_sim_t::prefetch_impl(uint64_t addr, bool miss)
+{
+  cache_t* self = static_cast<cache_t*>(this);
+  uint64_t line = addr >> idx_shift;
+  bool pf_hit = false;
+  if (miss) {
+    if (pf_evicted.erase(line))
+      pf_pollution++;
+  } else if (pf_unused.erase(line)) {
+    pf_useful++;
+    pf_hit = true;
+  }
+
+  uint64_t lines[prefetcher_t::MAX_LINES];
+  size_t n = prefetcher->observe(line, miss, pf_hit, lines);
+  for (size_t i = 0; i < n; i++) {
+    uint64_t pf_addr = lines[i] << idx_shift;
+    if ((pf_addr >> idx_shift) != lines[i] || (invalidate_level(pf_addr, false, false) & VALID))
+      continue;
+
+    pf_issued++;
+    uint64_t victim = self->cache_t::victimize(pf_addr);
+    note_victim(pf_addr, victim, true);
+    victim = victim_cache_insert(victim);
+    bool exclusive = miss_handler && miss_handler->inclusion == EXCLUSIVE;
+    if (!exclusive)
+      evict(victim);
+    bool dirty = miss_handler && miss_handler->fetch(pf_addr, linesz);
+    if (exclusive)
+      evict(victim);
+    if (dirty)
+      self->cache_t::set_dirty(pf_addr);
+    pf_unused.insert(lines[i]);
+  }
+}
+
+void cache_sim_t::shadow_access(uint64_t addr)
+{
+  if (shadow->hit(addr, false)) {
+    miss_class = CONFLICT;
+    return;
+  }
+  shadow->victimize(addr);
+
+  uint64_t line = addr >> idx_shift;
+  std::vector<uint64_t>& page = seen[line >> SEEN_PAGE_BITS];
+  if (page.empty())
+    page.resize((1 << SEEN_PAGE_BITS) / 64);
+  uint64_t& bits = page[(line & ((1 << SEEN_PAGE_BITS) - 1)) / 64];
+  uint64_t bit = 1ULL << (line & 63);
+  miss_class = (bits & bit) ? CAPACITY : COMPULSORY;
+  bits |= bit;
+}
+
+// 一個 set 一行，可以直接拿去畫 heatmap
+void cache_sim_t::write_heatmap()
+{
+  FILE* f = fopen(heatmap_path.c_str(), "w");
+  if (!f) {
+    std::cerr << "could not open " << heatmap_path << std::endl;
+    return;
+  }
+  fprintf(f, "set,accesses,misses,dirty_evictions,miss_rate\n");
+  for (size_t i = 0; i < set_stats.size(); i++) {
+    const set_stats_t& s = set_stats[i];
+    fprintf(f, "%zu,%llu,%llu,%llu,%.3f\n", i, (unsigned long long)s.accesses,
+            (unsigned long long)s.misses, (unsigned long long)s.dirty_evictions,
+            s.accesses ? 100.0 * s.misses / s.accesses : 0.0);
+  }
+  fclose(f);
+}
+
+void cache_sim_t::snapshot()
+{
+  interval_sample_t s = { read_accesses, write_accesses, read_misses, write_misses, writebacks };
+  intervals->push(s);
+  interval_left = interval;
+}
+
+void cache_sim_t::note_victim(uint64_t addr, uint64_t victim, bool by_prefetch)
+{
+  if (!(victim & VALID))
+    return;
+  if (!set_stats.empty() && (victim & DIRTY))
+    set_stats[set_index(addr)].dirty_evictions++;
+  if (!prefetcher)
+    return;
+  uint64_t line = victim & ~(VALID | DIRTY);
+  pf_unused.erase(line);
+  if (by_prefetch) {
+    if (pf_evicted.size() >= 4 * sets * ways)
+      pf_evicted.clear();
+    pf_evicted.insert(line);
+  }
+}
+
+// 上一層換掉的 victim 放進這一層，換出來的再往下交；已經在了 (例如 I$ 和 D$ 都拿過) 就只合併 dirty
+template <class cache_t>
+void cache_sim_t::fill_impl(uint64_t addr, bool dirty)
+{
+  cache_t* self = static_cast<cache_t*>(this);
+  victim_fills++;
+  if (self->cache_t::hit(addr, dirty))
+    return;
+  if (victim_cache)
+    dirty |= victim_cache->invalidate_line(addr, false, true) & DIRTY;
+  uint64_t victim = self->cache_t::victimize(addr);
+  note_victim(addr, victim, false);
+  victim = victim_cache_insert(victim);
+  if (dirty)
+    self->cache_t::set_dirty(addr);
+  evict(victim);
+}
+
+uint64_t cache_sim_t::victim_cache_insert(uint64_t victim)
+{
+  if (!victim_cache || !(victim & VALID))
+    return victim;
+  uint64_t victim_addr = (victim & ~(VALID | DIRTY)) << idx_shift;
+  uint64_t out = victim_cache->victimize(victim_addr);
+  if (victim & DIRTY)
+    victim_cache->set_dirty(victim_addr);
+  return out;
+}
+
+uint64_t cache_sim_t::invalidate_level(uint64_t addr, bool clean, bool inval)
+{
+  uint64_t state = invalidate_line(addr, clean, inval);
+  if (victim_cache && !(state & VALID)) {
+    state = victim_cache->invalidate_line(addr, clean, inval);
+    if (clean && (state & DIRTY))
+      writebacks++;
+  }
+  if (prefetcher && inval && (state & VALID))
+    pf_unused.erase(addr >> idx_shift);
+  return state;
+}
+
+// 如果受害者是有效的並且是 dirty 的，則將其寫回到下一級 cache 或主記憶體，並增加寫回計數
+// 這一層是 INCLUSIVE 的話先清掉上一層的 copy，上一層是 dirty 的話這條 line 也要寫回
+// 下一層是 EXCLUSIVE 的話乾淨的受害者也放進去
+void cache_sim_t::evict(uint64_t victim)
+{
+  if (!(victim & VALID))
+    return;
+  uint64_t victim_addr = (victim & ~(VALID | DIRTY)) << idx_shift;
+  bool dirty = victim & DIRTY;
+  if (inclusion == INCLUSIVE)
+    for (cache_sim_t* upper : uppers)
+      dirty |= upper->back_invalidate(victim_addr, linesz);
+
+  if (dirty)
+    writebacks++;
+  if (!miss_handler)
+    return;
+  if (miss_handler->inclusion == EXCLUSIVE)
+    miss_handler->fill(victim_addr, dirty);
+  else if (dirty)
+    miss_handler->access(victim_addr, linesz, true);
+}
+
+// NINE / INCLUSIVE 就是一般的讀取；EXCLUSIVE 有的話把 line 交出去 (這一層不留)，沒有的話往下拿，不放進這一層
+bool cache_sim_t::fetch(uint64_t addr, size_t bytes)
+{
+  if (inclusion != EXCLUSIVE) {
+    access(addr, bytes, false);
+    return false;
+  }
+
+  read_accesses++;
+  bytes_read += bytes;
+  if (shadow)
+    shadow_access(addr);
+  if (reuse)
+    reuse->access(addr >> idx_shift);
+  if (!set_stats.empty())
+    set_stats[set_index(addr)].accesses++;
+  uint64_t state = invalidate_level(addr, false, true);
+  if (!(state & VALID)) {
+    read_misses++;
+    if (shadow)
+      class_misses[miss_class]++;
+    if (!set_stats.empty())
+      set_stats[set_index(addr)].misses++;
+  }
+  if (unlikely(--interval_left == 0))
+    snapshot();
+  if (state & VALID)
+    return state & DIRTY;
+
+  if (log)
+    std::cerr << name << " read miss 0x" << std::hex << addr << std::endl;
+  return miss_handler && miss_handler->fetch(addr & ~(linesz-1), linesz);
+}
+
+bool cache_sim_t::back_invalidate(uint64_t addr, size_t bytes)
+{
+  bool dirty = false;
+  for (cache_sim_t* upper : uppers)
+    dirty |= upper->back_invalidate(addr, bytes);
+
+  uint64_t start_addr = addr & ~(linesz-1);
+  uint64_t end_addr = (addr + bytes + linesz-1) & ~(linesz-1);
+  for (uint64_t cur_addr = start_addr; cur_addr < end_addr; cur_addr += linesz) {
+    uint64_t state = invalidate_level(cur_addr, false, true);
+    if (state & VALID)
+      back_invalidations++;
+    if (state & DIRTY)
+      dirty = true;
+  }
+  return dirty;
+}
+
+void cache_sim_t::set_miss_handler(cache_sim_t* mh)
+{
+  if (miss_handler)
+    miss_handler->uppers.erase(std::remove(miss_handler->uppers.begin(), miss_handler->uppers.end(), this),
+                               miss_handler->uppers.end());
+  miss_handler = mh;
+  if (mh)
+    mh->uppers.push_back(this);
+}
+
+void cache_sim_t::access_batch(const cache_access_t* batch, size_t n)
+{
+  access_batch_impl<cache_sim_t>(batch, n);
+}
+
+void cache_sim_t::fill(uint64_t addr, bool dirty)
+{
+  fill_impl<cache_sim_t>(addr, dirty);
+}
+
+size_t cache_sim_t::hash_index(uint64_t line) const
+{
+  switch (index_fn) {
+    case INDEX_XOR: {
+      if (index_bits == 0)
+        return 0;
+      uint64_t idx = line;
+      for (uint64_t x = line >> index_bits; x; x >>= index_bits)
+        idx ^= x;
+      return idx & (sets-1);
+    }
+    case INDEX_PRIME:
+      return line % prime_sets;
+    case INDEX_SKEW:
+      return skew_index(line, 0); // 只有 heatmap 會用到，算成第 0 個 way 的 set
+    default:
+      return line & (sets-1);
+  }
+}
+
+// 低位 XOR 上高位乘一個每個 way 不一樣的奇數 (Fibonacci hashing) 取出來的 index_bits bits
+// tag (高位) 一樣的 line 在每個 way 裡還是各自一個 set，tag 不一樣的在不同的 way 會被打散到不同的組合
+size_t cache_sim_t::skew_index(uint64_t line, size_t way) const
+{
+  if (index_bits == 0)
+    return 0;
+  uint64_t k = 0x9e3779b97f4a7c15ULL * (2 * way + 1);
+  return (line ^ (((line >> index_bits) * k) >> (64 - index_bits))) & (sets-1);
+}
+
+uint64_t cache_sim_t::invalidate_line(uint64_t addr, bool clean, bool inval)
+{
+  uint64_t* hit_way = check_tag(addr);
+  if (hit_way == NULL)
+    return 0;
+  uint64_t state = *hit_way & (VALID | DIRTY);
+  if (clean) {
+    if (*hit_way & DIRTY) {
+      writebacks++;
+      *hit_way &= ~DIRTY;
+    }
+  }
+
+  if (inval)
+    *hit_way &= ~VALID;
+  return state;
+}
+
+void cache_sim_t::clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool inval)
+{
+  uint64_t start_addr = addr & ~(linesz-1);
+  uint64_t end_addr = (addr + bytes + linesz-1) & ~(linesz-1);
+  uint64_t cur_addr = start_addr;
+  while (cur_addr < end_addr) {
+    invalidate_level(cur_addr, clean, inval);
+    cur_addr += linesz;
+  }
+  if (miss_handler)
+    miss_handler->clean_invalidate(addr, bytes, clean, inval);
+}
+
+fa_cache_sim_t::fa_cache_sim_t(size_t ways, size_t linesz, const char* name, order_t order)
+  : cache_sim_t(1, ways, linesz, name), order(order), nodes(order == ARC ? 2 * ways : ways), arc_p(0)
+{
+  size_t table_size = 2;
+  table_shift = 63;
+  while (table_size < 2 * nodes.size()) {
+    table_size *= 2;
+    table_shift--;
+  }
+  slot_t empty = { EMPTY, NONE };
+  table.assign(table_size, empty);
+
+  for (size_t l = 0; l < NLISTS; l++) {
+    lists[l].head = lists[l].tail = NONE;
+    lists[l].size = 0;
+  }
+
+  // 一開始所有 node 都在 free list 上
+  for (size_t i = 0; i < nodes.size(); i++)
+    nodes[i].next = i + 1 < nodes.size() ? i + 1 : NONE;
+  free_list = 0;
+}
+
+void fa_cache_sim_t::access_batch(const cache_access_t* batch, size_t n)
+{
+  access_batch_impl<fa_cache_sim_t>(batch, n);
+}
+
+void fa_cache_sim_t::fill(uint64_t addr, bool dirty)
+{
+  fill_impl<fa_cache_sim_t>(addr, dirty);
+}
+
+size_t fa_cache_sim_t::find_slot(uint64_t line) const
+{
+  // Fibonacci hashing：乘上 2^64 / 黃金比例，取最高的幾個 bits
+  size_t mask = table.size() - 1;
+  size_t i = (line * 0x9e3779b97f4a7c15ULL) >> table_shift;
+  while (table[i].line != line && table[i].line != EMPTY)
+    i = (i + 1) & mask;
+  return i;
+}
+
+void fa_cache_sim_t::insert(uint64_t line, uint32_t n)
+{
+  slot_t& slot = table[find_slot(line)];
+  slot.line = line;
+  slot.node = n;
+}
+
+// linear probing 的刪除：把後面同一串裡可以往前搬的格子搬上來，不用留墓碑
+void fa_cache_sim_t::erase(uint64_t line)
+{
+  size_t mask = table.size() - 1;
+  size_t i = find_slot(line);
+  for (size_t j = (i + 1) & mask; table[j].line != EMPTY; j = (j + 1) & mask) {
+    size_t home = (table[j].line * 0x9e3779b97f4a7c15ULL) >> table_shift;
+    // home 不在 (i, j] 之間的話，j 放到 i 也找得到
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      table[i] = table[j];
+      i = j;
+    }
+  }
+  table[i].line = EMPTY;
+  table[i].node = NONE;
+}
+
+void fa_cache_sim_t::unlink(uint32_t n)
+{
+  node_t& x = nodes[n];
+  list_t& l = lists[x.list];
+  (x.prev == NONE ? l.head : nodes[x.prev].next) = x.next;
+  (x.next == NONE ? l.tail : nodes[x.next].prev) = x.prev;
+  l.size--;
+}
+
+void fa_cache_sim_t::push_front(uint32_t n, list_id_t list)
+{
+  list_t& l = lists[list];
+  nodes[n].list = list;
+  nodes[n].prev = NONE;
+  nodes[n].next = l.head;
+  (l.head == NONE ? l.tail : nodes[l.head].prev) = n;
+  l.head = n;
+  l.size++;
+}
+
+uint32_t fa_cache_sim_t::alloc_node()
+{
+  uint32_t n = free_list;
+  free_list = nodes[n].next;
+  return n;
+}
+
+void fa_cache_sim_t::free_node(uint32_t n)
+{
+  nodes[n].next = free_list;
+  free_list = n;
+}
+
+bool fa_cache_sim_t::hit(uint64_t addr, bool store)
+{
+  uint32_t n = find(addr >> idx_shift);
+  if (n == NONE || nodes[n].list >= B1) // ghost 只有 tag，算 miss
+    return false;
+  if ((order == LRU && n != lists[T1].head) || order == ARC) {
+    // ARC：第二次用到就搬到 T2；寫入 miss 放進來的 line 由 set_dirty() 設 dirty，還留在 T1
+    unlink(n);
+    push_front(n, order == ARC ? T2 : T1);
+  }
+  if (store)
+    nodes[n].tag |= DIRTY;
+  return true;
+}
+
+void fa_cache_sim_t::set_dirty(uint64_t addr)
+{
+  uint32_t n = find(addr >> idx_shift);
+  if (n != NONE && nodes[n].list < B1)
+    nodes[n].tag |= DIRTY;
+}
+
+uint64_t fa_cache_sim_t::victimize(uint64_t addr)
+{
+  uint64_t line = addr >> idx_shift;
+  if (order == ARC)
+    return arc_victimize(line);
+
+  uint64_t old_tag = 0;
+  uint32_t n;
+  if (free_list != NONE) {
+    // 還有空的 block 就先用空的
+    n = alloc_node();
+  } else {
+    // 快取已經滿了：RANDOM 隨便挑一個，FIFO / LRU 換掉 list 最後面的
+    n = order == RANDOM ? lfsr.next() % ways : lists[T1].tail;
+    old_tag = nodes[n].tag;
+    erase(old_tag & ~(VALID | DIRTY));
+    unlink(n);
+  }
+
+  // 將新的地址添加到快取中
+  nodes[n].tag = line | VALID;
+  insert(line, n);
+  push_front(n, T1);
+
+  // 返回被替換的標籤
+  return old_tag;
+}
+
+// ARC 的 REPLACE：cache 滿了才換，T1 超過目標大小 p 就從 T1 換，不然從 T2 換
+// 換掉的 block 變成 B1 / B2 最前面的 ghost，回傳它原本的 tag
+uint64_t fa_cache_sim_t::arc_replace(bool in_b2)
+{
+  size_t t1 = lists[T1].size;
+  if (t1 + lists[T2].size < ways)
+    return 0;
+
+  bool from_t1 = t1 && ((in_b2 && t1 == arc_p) || t1 > arc_p || lists[T2].size == 0);
+  uint32_t n = lists[from_t1 ? T1 : T2].tail;
+  uint64_t old_tag = nodes[n].tag;
+  unlink(n);
+  nodes[n].tag = old_tag & ~(VALID | DIRTY);
+  push_front(n, from_t1 ? B1 : B2);
+  return old_tag;
+}
+
+// 把 list 最後面的 node (ghost 或是 T1 的 block) 整個丟掉
+void fa_cache_sim_t::arc_drop(list_id_t list)
+{
+  uint32_t n = lists[list].tail;
+  erase(nodes[n].tag & ~(VALID | DIRTY));
+  unlink(n);
+  free_node(n);
+}
+
+uint64_t fa_cache_sim_t::arc_victimize(uint64_t line)
+{
+  uint64_t old_tag = 0;
+  uint32_t n = find(line);
+
+  if (n != NONE) {
+    // miss 到 ghost：B1 的 ghost 代表 T1 太小，B2 的代表 T2 太小，p 往那邊調
+    size_t b1 = lists[B1].size, b2 = lists[B2].size;
+    bool in_b2 = nodes[n].list == B2;
+    if (!in_b2)
+      arc_p = std::min(ways, arc_p + std::max(b2 / b1, size_t(1)));
+    else
+      arc_p -= std::min(arc_p, std::max(b1 / b2, size_t(1)));
+    old_tag = arc_replace(in_b2);
+    unlink(n);
+    nodes[n].tag = line | VALID;
+    push_front(n, T2);
+    return old_tag;
+  }
+
+  // 完全沒看過的 line：先讓 T1 + B1 和全部的 node 數不超過 c 和 2c，再放進 T1
+  size_t l1 = lists[T1].size + lists[B1].size;
+  size_t total = l1 + lists[T2].size + lists[B2].size;
+  if (l1 >= ways) {
+    if (lists[T1].size < ways) {
+      arc_drop(B1);
+      old_tag = arc_replace(false);
+    } else {
+      old_tag = nodes[lists[T1].tail].tag;
+      arc_drop(T1);
+    }
+  } else if (total >= ways) {
+    if (total >= 2 * ways)
+      arc_drop(B2);
+    old_tag = arc_replace(false);
+  }
+
+  n = alloc_node();
+  nodes[n].tag = line | VALID;
+  insert(line, n);
+  push_front(n, T1);
+  return old_tag;
+}
+
+uint64_t fa_cache_sim_t::invalidate_line(uint64_t addr, bool clean, bool inval)
+{
+  uint64_t line = addr >> idx_shift;
+  uint32_t n = find(line);
+  if (n == NONE || nodes[n].list >= B1)
+    return 0;
+  uint64_t state = nodes[n].tag & (VALID | DIRTY);
+  if (clean && (nodes[n].tag & DIRTY)) {
+    writebacks++;
+    nodes[n].tag &= ~DIRTY;
+  }
+  if (inval) {
+    // 無效化的 block 還給 free list
+    erase(line);
+    unlink(n);
+    free_node(n);
+  }
+  return state;
+}
+
+skew_cache_sim_t::skew_cache_sim_t(size_t sets, size_t ways, size_t linesz, const char* name, order_t order)
+  : cache_sim_t(sets, ways, linesz, name), order(order), stamp(sets * ways, 0), clock(0)
+{
+  // find() 不檢查 tags 是不是 NULL，一開始就配置好
+  tags = new uint64_t[sets*ways]();
+}
+
+void skew_cache_sim_t::access_batch(const cache_access_t* batch, size_t n)
+{
+  access_batch_impl<skew_cache_sim_t>(batch, n);
+}
+
+void skew_cache_sim_t::fill(uint64_t addr, bool dirty)
+{
+  fill_impl<skew_cache_sim_t>(addr, dirty);
+}
+
+uint64_t* skew_cache_sim_t::find(uint64_t line)
+{
+  uint64_t tag = line | VALID;
+  for (size_t w = 0; w < ways; w++) {
+    uint64_t* t = &tags[slot(line, w)];
+    if ((*t & ~DIRTY) == tag)
+      return t;
+  }
+  return NULL;
+}
+
+bool skew_cache_sim_t::hit(uint64_t addr, bool store)
+{
+  uint64_t* t = find(addr >> idx_shift);
+  if (t == NULL)
+    return false;
+  if (order == LRU)
+    stamp[t - tags] = ++clock;
+  if (store)
+    *t |= DIRTY;
+  return true;
+}
+
+void skew_cache_sim_t::set_dirty(uint64_t addr)
+{
+  if (uint64_t* t = find(addr >> idx_shift))
+    *t |= DIRTY;
+}
+
+uint64_t skew_cache_sim_t::victimize(uint64_t addr)
+{
+  // 候選是每個 way 各自 hash 到的那一格：有空的先用空的，不然照 order 挑
+  uint64_t line = addr >> idx_shift;
+  size_t victim = slot(line, 0);
+  for (size_t w = 0; w < ways; w++) {
+    size_t i = slot(line, w);
+    if (!(tags[i] & VALID)) {
+      victim = i;
+      break;
+    }
+    if (order != RANDOM && stamp[i] < stamp[victim])
+      victim = i;
+  }
+  if ((tags[victim] & VALID) && order == RANDOM)
+    victim = slot(line, lfsr.next() % ways);
+
+  uint64_t old_tag = tags[victim];
+  tags[victim] = line | VALID;
+  stamp[victim] = ++clock;
+  return old_tag;
+}
+
+uint64_t skew_cache_sim_t::invalidate_line(uint64_t addr, bool clean, bool inval)
+{
+  uint64_t* t = find(addr >> idx_shift);
+  if (t == NULL)
+    return 0;
+  uint64_t state = *t & (VALID | DIRTY);
+  if (clean && (*t & DIRTY)) {
+    writebacks++;
+    *t &= ~DIRTY;
+  }
+  if (inval)
+    *t = 0;
+  return state;
+}
+
+// hierarchy 的 spec 寫錯時印出格式並結束
+static void hierarchy_help()
+{
+  std::cerr << "Cache hierarchies must be of the form" << std::endl;
+  std::cerr << "  L1D=<config>,L2=<config>,L3=<config>,...[,mem=<cycles>]" << std::endl;
+  std::cerr << "where the first level is L1, L1I or L1D, the following levels are" << std::endl;
+  std::cerr << "L2, L3, ... in order, and each <config> is a cache configuration that" << std::endl;
+  std::cerr << "may end with :lat=<cycles>, the hit latency of that level." << std::endl;
+  std::cerr << "Levels below the first may also take :incl=inclusive or :incl=exclusive." << std::endl;
+  std::cerr << "Default latencies are 4 (L1), 12 (L2), 40 (L3 and below) and mem=200." << std::endl;
+  exit(1);
+}
+
+cache_hierarchy_t::cache_hierarchy_t(const char* spec)
+  : mem_latency(200)
+{
+  std::string rest(spec);
+  bool done = false;
+  while (!rest.empty()) {
+    size_t comma = rest.find(',');
+    std::string item = rest.substr(0, comma);
+    rest = comma == std::string::npos ? "" : rest.substr(comma + 1);
+
+    size_t eq = item.find('=');
+    if (eq == std::string::npos || done)
+      hierarchy_help();
+    std::string key = item.substr(0, eq), config = item.substr(eq + 1);
+
+    // mem=<cycles> 一定是最後一個
+    if (key == "mem") {
+      char* end;
+      mem_latency = strtoul(config.c_str(), &end, 0);
+      if (config.empty() || *end)
+        hierarchy_help();
+      done = true;
+      continue;
+    }
+
+    // 第一層是 L1 / L1I / L1D，之後是 L2、L3 ...
+    size_t n = levels.size() + 1;
+    bool ok = n == 1 ? (key == "L1" || key == "L1I" || key == "L1D") : key == "L" + std::to_string(n);
+    if (!ok)
+      hierarchy_help();
+
+    // lat=<cycles> 是 hierarchy 的選項，拿掉之後剩下的交給 construct()
+    level_t level;
+    level.name = key;
+    level.latency = n == 1 ? 4 : n == 2 ? 12 : 40;
+    std::string cache_config;
+    size_t start = 0;
+    for (size_t field_no = 0; start <= config.size(); field_no++) {
+      size_t colon = config.find(':', start);
+      std::string field = config.substr(start, colon == std::string::npos ? std::string::npos : colon - start);
+      if (field_no >= 3 && field.compare(0, 4, "lat=") == 0) {
+        char* end;
+        level.latency = strtoul(field.c_str() + 4, &end, 0);
+        if (field.size() == 4 || *end)
+          hierarchy_help();
+      } else {
+        cache_config += (cache_config.empty() ? "" : ":") + field;
+      }
+      if (colon == std::string::npos)
+        break;
+      start = colon + 1;
+    }
+    level.cache = cache_sim_t::construct(cache_config.c_str(), level.name.c_str());
+    if (!levels.empty())
+      levels.back().cache->set_miss_handler(level.cache);
+    levels.push_back(level);
+  }
+  if (levels.empty())
+    hierarchy_help();
+}
+
+// AMAT = 第一層的 hit 時間 + miss rate * (下一層的 AMAT)，最後一層的下一層是 memory
+// 每一層的 miss rate 是那一層自己的 (local) miss rate，存取次數包含上一層的寫回
+double cache_hierarchy_t::amat() const
+{
+  double t = mem_latency;
+  for (size_t i = levels.size(); i-- > 0; ) {
+    const cache_sim_t* c = levels[i].cache;
+    double mr = c->accesses() ? double(c->misses()) / c->accesses() : 0;
+    t = levels[i].latency + mr * t;
+  }
+  return t;
+}
+
+cache_hierarchy_t::~cache_hierarchy_t()
+{
+  bool used = first()->accesses() != 0;
+  double t = amat();
+
+  for (size_t i = 0; i < levels.size(); i++)
+    delete levels[i].cache;
+
+  if (used) {
+    std::cout << std::setprecision(3) << std::fixed;
+    std::cout << levels.front().name << " ";
+    std::cout << "AMAT:                  " << t << " cycles" << std::endl;
+  }
+}
@@ -0,0 +1,442 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_CACHE_SIM_H
+#define _RISCV_CACHE_SIM_H
+
+#include "memtracer.h"
+#include "memtrace.h"
+#include "common.h"
+#include <cstring>
+#include <string>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+class lfsr_t
+{
+ public:
+  lfsr_t() : reg(1) {}
+  lfsr_t(const lfsr_t& lfsr) : reg(lfsr.reg) {}
+  uint32_t next() { return reg = (reg>>1)^(-(reg&1) & 0xd0000001); }
+ private:
+  uint32_t reg;
+};
+
+// access_batch() 一次處理的一筆存取
+struct cache_access_t
+{
+  uint64_t addr;
+  uint32_t bytes;
+  bool store;
+};
+
+// config 裡 policy 後面的 key=value 選項
+// 各個部分用 take_option() 拿走自己的選項，construct() 最後還剩下的就是寫錯了
+typedef std::map<std::string, std::string> cache_options_t;
+size_t take_option(cache_options_t& opts, const char* key, size_t def);
+
+class fa_cache_sim_t;
+class prefetcher_t;
+class reuse_profiler_t;
+class interval_log_t;
+
+class cache_sim_t
+{
+ public:
+  // size_t 就是 unsigned long long 在 64 bits 的電腦裡
+  cache_sim_t(size_t sets, size_t ways, size_t linesz, const char* name); // constructor
+  cache_sim_t(const cache_sim_t& rhs); // copy constructor
+  virtual ~cache_sim_t(); // destructor
+
+  void access(uint64_t addr, size_t bytes, bool store) // 存取 cache
+  {
+    cache_access_t a = { addr, uint32_t(bytes), store };
+    access_batch(&a, 1);
+  }
+  // 一次存取一整批，每個 policy 各自 override，迴圈裡的 hit / victimize 不用再經過 virtual
+  virtual void access_batch(const cache_access_t* batch, size_t n);
+  void clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool inval); // 清除或無效化 cache
+  void print_stats(); // 印出統計資料
+  uint64_t accesses() const { return read_accesses + write_accesses; }
+  uint64_t misses() const { return read_misses + write_misses; }
+  void set_miss_handler(cache_sim_t* mh); // 設定 miss handler，這個 cache 也會變成 mh 的上一層
+  void set_log(bool _log) { log = _log; } // 設定是否紀錄 log
+
+  // 建立 cache_sim_t or fully associative cache
+  // config = "sets:ways:blocksize[:policy][:key=value]..."，policy 和選項見 cachesim.cc 的 help()
+  static cache_sim_t* construct(const char* config, const char* name);
+
+  // 這一層跟上一層 (把它當 miss handler 的 cache) 的關係，config 的 incl= 選項
+  // NINE：原本的行為，兩層各自換自己的 line，下一層只看到上一層的 miss 和 dirty 的寫回
+  // INCLUSIVE：這一層換掉一條 line 時，上一層的 copy 也一起清掉 (back-invalidation)，
+  //   上一層的 copy 是 dirty 的話跟著這一層的 victim 一起寫回
+  // EXCLUSIVE：上一層 miss 時 line 從這一層搬上去 (這一層不留，這一層也 miss 的話不放進來)，
+  //   上一層換掉的 line 不管 dirty 與否都放進這一層；兩層的 blocksize 不一樣時只是近似
+  enum inclusion_t { NINE, INCLUSIVE, EXCLUSIVE };
+
+ protected:
+  static const uint64_t VALID = 1ULL << 63; // VALID = 二進位 10000000000000000000000000000000000000000000000000000000000000000000000
+  static const uint64_t DIRTY = 1ULL << 62; // DIRTY = 二進位 01000000000000000000000000000000000000000000000000000000000000000000000
+
+  virtual uint64_t* check_tag(uint64_t addr);
+  virtual uint64_t victimize(uint64_t addr);
+  // 對一條 line 做 clean / invalidate，回傳它原本的狀態 (VALID | DIRTY，不在 cache 裡是 0)，不會往下一層傳
+  virtual uint64_t invalidate_line(uint64_t addr, bool clean, bool inval);
+  // 上一層換掉的 victim 放進這一層 (EXCLUSIVE)
+  virtual void fill(uint64_t addr, bool dirty);
+
+  // 上一層 miss 時來拿 line，回傳拿到的 line 是不是 dirty 的 (只有 EXCLUSIVE 會拿到 dirty 的)
+  bool fetch(uint64_t addr, size_t bytes);
+  // victimize() 換出來的 victim 交給下一層
+  void evict(uint64_t victim);
+  // 下一層 (INCLUSIVE) 換掉了 [addr, addr+bytes)，清掉這一層和更上層的 copy，回傳其中有沒有 dirty 的
+  bool back_invalidate(uint64_t addr, size_t bytes);
+  // 跟 invalidate_line() 一樣，但 victim cache 裡的 line 也算這一層的
+  uint64_t invalidate_level(uint64_t addr, bool clean, bool inval);
+  // 把 victimize() 換出來的 line 放進 victim cache，回傳從 victim cache 擠出來、真的要離開這一層的 line
+  uint64_t victim_cache_insert(uint64_t victim);
+
+  // 找到 addr 就更新 replacement 的狀態、寫入時設 dirty，回傳有沒有 hit
+  bool hit(uint64_t addr, bool store);
+  // 剛 victimize() 放進來的 line 設 dirty，不動 replacement 的狀態 (放進來那次不算 reuse)
+  void set_dirty(uint64_t addr);
+
+  // access_batch() 的本體，cache_t 是實際的 class，用到 cache_t 的 hit() / victimize()，定義在 cachesim.cc
+  template <class cache_t> void access_batch_impl(const cache_access_t* batch, size_t n);
+  template <class cache_t> void access_miss(uint64_t addr, bool store);
+  template <class cache_t> void fill_impl(uint64_t addr, bool dirty);
+  // 把這次 demand 存取交給 prefetcher，再把它要的 line 抓進來；miss 是 demand miss
+  template <class cache_t> void prefetch_impl(uint64_t addr, bool miss);
+  // victimize() 在 addr 的 set 換掉了 victim：記 per-set 的 dirty eviction，
+  // 還沒用到的 prefetch 不再算，被 prefetch 擠掉的記下來算 pollution
+  void note_victim(uint64_t addr, uint64_t victim, bool by_prefetch);
+  size_t set_index(uint64_t addr) const { return index_of(addr >> idx_shift); }
+
+  // line address 對應到哪個 set，config 的 index= 選項：
+  // mod (預設)：line 的低位 (line & (sets-1))
+  // xor：line 的每一段 log2(sets) bits 全部 XOR 起來，2 的次方的 stride 也會分散到不同的 set
+  // prime：line % (不超過 sets 的最大質數)，多出來的幾個 set 不用
+  // skew：skewed-associative，每個 way 用不同的 hash (skew_index)，由 skew_cache_sim_t 處理
+  // tag 都存完整的 line address，寫回時不用從 index 反推
+  enum index_fn_t { INDEX_MOD, INDEX_XOR, INDEX_PRIME, INDEX_SKEW };
+  size_t index_of(uint64_t line) const
+  {
+    if (likely(index_fn == INDEX_MOD))
+      return line & (sets-1);
+    return hash_index(line);
+  }
+  size_t hash_index(uint64_t line) const;
+  size_t skew_index(uint64_t line, size_t way) const;
+  void write_heatmap();
+  // 每次 demand 存取先走一次 shadow，記下這次存取如果 miss 要算哪一種
+  void shadow_access(uint64_t addr);
+  // 把現在的累計計數記一筆到 intervals，重新開始倒數
+  void snapshot();
+
+  lfsr_t lfsr;
+  cache_sim_t* miss_handler;
+  std::vector<cache_sim_t*> uppers; // 把這一層當 miss handler 的 cache
+  inclusion_t inclusion;
+  index_fn_t index_fn;
+  size_t index_bits; // log2(sets)
+  size_t prime_sets; // 不超過 sets 的最大質數
+  // config 的 vc=N：N 個 block 的 fully-associative LRU victim cache，放在這個 cache 和 miss handler 中間
+  // 換掉的 line 先進 victim cache，miss 時在 victim cache 找到就跟換掉的 line 對調 (swap)，不用去下一層
+  fa_cache_sim_t* victim_cache;
+  // config 的 pf=next / stride / stream (見 prefetch.h)
+  prefetcher_t* prefetcher;
+  std::unordered_set<uint64_t> pf_unused; // prefetch 進來、還沒被 demand 用到的 line
+  std::unordered_set<uint64_t> pf_evicted; // 被 prefetch 擠出去、還沒再用到的 line，最多留 4 倍 cache 的 line 數
+  // config 的 3c=1：把每個 miss 分成 compulsory / capacity / conflict (3C)
+  // shadow 是容量一樣的 fully-associative LRU，shadow 也 miss 就是 capacity，shadow hit 就是 conflict，
+  // 從來沒看過的 line 是 compulsory
+  enum miss_class_t { COMPULSORY, CAPACITY, CONFLICT, NCLASSES };
+  fa_cache_sim_t* shadow;
+  // seen 是分頁的 bitmap，一頁記 2^SEEN_PAGE_BITS 條連續的 line (8 KiB)，碰到新的一頁才配置，
+  // 只有 shadow miss 才查；頁不會釋放，記憶體跟 trace 碰過的範圍一起長 (64-byte block 時每 4 MiB 一頁)
+  static const unsigned SEEN_PAGE_BITS = 16;
+  std::unordered_map<uint64_t, std::vector<uint64_t>> seen;
+  miss_class_t miss_class; // 這次存取如果 miss 是哪一種
+  // config 的 rd=N：記錄 demand 存取的 reuse distance (見 stackdist.h)，N > 1 時只取樣 1/N 的 line
+  reuse_profiler_t* reuse;
+  // config 的 interval=N：每 N 次存取記一筆計數 (見 interval.h)，interval_left 倒數到 0 就記
+  interval_log_t* intervals;
+  uint64_t interval;
+  uint64_t interval_left;
+  // config 的 heatmap=1：每個 set 各自的計數，結束時寫成 <name>.sets.csv (檔名見 interval.h 的 cache_stats_path)
+  struct set_stats_t
+  {
+    uint64_t accesses;
+    uint64_t misses;
+    uint64_t dirty_evictions;
+  };
+  std::vector<set_stats_t> set_stats; // 沒開的話是空的
+  std::string heatmap_path;
+
+  size_t sets; // 幾條 cache entries
+  size_t ways; // 一條 entry 有幾個 block
+  size_t linesz; // block size
+  size_t idx_shift; // idx_shift = log2(linesz), initialized in init()
+
+  uint64_t* tags; // 只有直接用 tags 的 engine 才配置 (第一次 victimize 的時候)
+  
+  uint64_t read_accesses;
+  uint64_t read_misses;
+  uint64_t bytes_read;
+  uint64_t write_accesses;
+  uint64_t write_misses;
+  uint64_t bytes_written;
+  uint64_t writebacks;
+  uint64_t back_invalidations; // 被下一層 back-invalidate 清掉的 line
+  uint64_t victim_fills; // EXCLUSIVE：上一層放進來的 victim
+  uint64_t swap_hits; // miss 但在 victim cache 找到的次數，不算在 read_misses / write_misses
+  uint64_t pf_issued; // 真的抓進來的 prefetch (已經在 cache 裡的不算)
+  uint64_t pf_useful; // prefetch 進來之後被 demand 用到的
+  uint64_t pf_pollution; // demand miss 的 line 是被 prefetch 擠掉的
+  uint64_t class_misses[NCLASSES];
+
+  std::string name;
+  bool log;
+
+  void init();
+};
+
+// fa_cache_sim_t 是一個 Fully Associative 的 cache 模擬類別
+// line 用 open addressing 的 hash table 找，block 串成雙向 list，node 一開始就配好，miss 時不用 new
+// RANDOM：跟原本 spike 一樣用 lfsr 隨便挑一個換掉
+// FIFO：list 最前面是最新放進來的，換掉最後面的
+// LRU：hit 時搬到 list 最前面，換掉最後面的
+// ARC (Megiddo & Modha, FAST '03)：T1 放只用過一次的 block、T2 放用過兩次以上的，
+//   B1 / B2 是最近從 T1 / T2 被換掉的 tag (ghost，只留 tag)，miss 到 ghost 時調整 T1 的目標大小 p，
+//   看 recency 和 frequency 哪邊比較有用就多分一點空間給它；ghost 也放在 node pool 和 hash table 裡
+class fa_cache_sim_t : public cache_sim_t
+{
+ public:
+  enum order_t { RANDOM, FIFO, LRU, ARC };
+
+  fa_cache_sim_t(size_t ways, size_t linesz, const char* name, order_t order = RANDOM);
+  void access_batch(const cache_access_t* batch, size_t n);
+  bool hit(uint64_t addr, bool store);
+  void set_dirty(uint64_t addr);
+  uint64_t victimize(uint64_t addr); // 選一個 victim
+  uint64_t invalidate_line(uint64_t addr, bool clean, bool inval);
+  void fill(uint64_t addr, bool dirty);
+ private:
+  static const uint32_t NONE = 0xffffffff;
+  static const uint64_t EMPTY = ~0ULL; // hash table 的空格子
+  enum list_id_t { T1, T2, B1, B2, NLISTS }; // RANDOM / FIFO / LRU 只用 T1
+
+  struct node_t
+  {
+    uint64_t tag; // 跟 cache_sim_t 的 tags 一樣：line address | VALID | DIRTY，ghost 沒有 VALID
+    uint32_t prev, next;
+    uint8_t list;
+  };
+  struct slot_t
+  {
+    uint64_t line;
+    uint32_t node;
+  };
+  struct list_t
+  {
+    uint32_t head, tail; // head 是最新的
+    size_t size;
+  };
+
+  size_t find_slot(uint64_t line) const; // line 所在的格子，沒有的話是它該放的空格子
+  uint32_t find(uint64_t line) const { return table[find_slot(line)].node; }
+  void insert(uint64_t line, uint32_t n);
+  void erase(uint64_t line);
+  void unlink(uint32_t n);
+  void push_front(uint32_t n, list_id_t list);
+  uint32_t alloc_node();
+  void free_node(uint32_t n);
+
+  uint64_t arc_victimize(uint64_t line);
+  uint64_t arc_replace(bool in_b2);
+  void arc_drop(list_id_t list);
+
+  order_t order;
+  std::vector<node_t> nodes; // ways 個 block (ARC 再多 ways 個給 ghost)
+  std::vector<slot_t> table; // 2 的次方格，至少是 node 數的兩倍
+  size_t table_shift; // hash 取高位的 bits 當 index
+  list_t lists[NLISTS];
+  uint32_t free_list; // 沒在用的 node，用 next 串起來
+  size_t arc_p; // ARC 給 T1 的目標大小
+};
+
+// skewed-associative cache (Seznec, ISCA '93)：第 w 個 way 用 skew_index(line, w) 找 set，
+// 在某個 way 撞在一起的 line 到了別的 way 通常會分開；一條 line 可能放在 ways 個不同的 set
+// 所以沒辦法用 cache_core_t 一個 set 一筆 record 的存法，tag 放在 cache_sim_t 的 tags[set*ways + way]
+// RANDOM：原本 spike 的 lfsr；FIFO / LRU：每格記放進來 / 最後用到的時間，換掉 ways 個候選裡最舊的
+class skew_cache_sim_t : public cache_sim_t
+{
+ public:
+  enum order_t { RANDOM, FIFO, LRU };
+
+  skew_cache_sim_t(size_t sets, size_t ways, size_t linesz, const char* name, order_t order);
+  void access_batch(const cache_access_t* batch, size_t n);
+  bool hit(uint64_t addr, bool store);
+  void set_dirty(uint64_t addr);
+  uint64_t victimize(uint64_t addr);
+  uint64_t invalidate_line(uint64_t addr, bool clean, bool inval);
+  void fill(uint64_t addr, bool dirty);
+ private:
+  size_t slot(uint64_t line, size_t way) const { return skew_index(line, way) * ways + way; }
+  uint64_t* find(uint64_t line);
+
+  order_t order;
+  std::vector<uint64_t> stamp; // 每格的時間，跟 tags 一樣排
+  uint64_t clock;
+};
+
+// 一整串 cache，spec = "L1D=<config>,L2=<config>,L3=<config>,...[,mem=<cycles>]"
+// 第一層的名字是 L1 / L1I / L1D，後面依序是 L2、L3 ...，每一層的 miss handler 是下一層
+// 每一層的 config 後面可以多一個 lat=<cycles> 選項，是這一層 hit 要花的時間；mem 是最後一層 miss 去 memory 的時間
+// 第二層以後的 config 可以加 incl=inclusive / exclusive (見 cache_sim_t::inclusion_t) 決定跟上一層的關係
+// 結束時由上到下每一層印出自己的統計資料，最後印出第一層看到的 AMAT
+class cache_hierarchy_t
+{
+ public:
+  cache_hierarchy_t(const char* spec);
+  ~cache_hierarchy_t();
+
+  // config 的 '=' 在第一個 ':' 前面就是 hierarchy 的 spec
+  static bool is_spec(const char* config)
+  {
+    const char* eq = strchr(config, '=');
+    const char* colon = strchr(config, ':');
+    return eq && (!colon || eq < colon);
+  }
+
+  cache_sim_t* first() const { return levels.front().cache; }
+  cache_sim_t* last() const { return levels.back().cache; }
+  double amat() const;
+
+ private:
+  struct level_t
+  {
+    std::string name;
+    cache_sim_t* cache;
+    size_t latency;
+  };
+
+  std::vector<level_t> levels;
+  size_t mem_latency;
+};
+
+class cache_memtracer_t : public memtracer_t
+{
+ public:
+  cache_memtracer_t(const char* config, const char* name)
+  {
+    // --dc=L1D=...,L2=... 的話整串 cache 都由這個 memtracer 建立，外面接的 miss handler 放在最後一層
+    hierarchy = NULL;
+    if (cache_hierarchy_t::is_spec(config)) {
+      hierarchy = new cache_hierarchy_t(config);
+      cache = hierarchy->first();
+    } else {
+      cache = cache_sim_t::construct(config, name);
+    }
+    recorder = memtrace_writer_t::acquire_shared(); // 有設 CACHESIM_TRACE 才會錄 trace
+    pending = 0;
+    buffered = true;
+  }
+  ~cache_memtracer_t()
+  {
+    flush();
+    if (hierarchy)
+      delete hierarchy;
+    else
+      delete cache;
+    if (recorder)
+      memtrace_writer_t::release_shared();
+  }
+  void set_miss_handler(cache_sim_t* mh)
+  {
+    // 下一層 (L2) 是 I$ / D$ 共用的，先攢起來再送會打亂它看到的存取順序，所以有 miss handler 就不攢
+    flush();
+    buffered = (mh == NULL);
+    (hierarchy ? hierarchy->last() : cache)->set_miss_handler(mh);
+  }
+  void clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool inval)
+  {
+    flush();
+    cache->clean_invalidate(addr, bytes, clean, inval);
+  }
+  void set_log(bool log)
+  {
+    cache->set_log(log);
+  }
+
+ protected:
+  static const size_t BATCH_SIZE = 256;
+
+  void push(uint64_t addr, size_t bytes, bool store)
+  {
+    if (unlikely(!buffered)) {
+      cache->access(addr, bytes, store);
+      return;
+    }
+    cache_access_t& a = batch[pending];
+    a.addr = addr;
+    a.bytes = uint32_t(bytes);
+    a.store = store;
+    if (++pending == BATCH_SIZE)
+      flush();
+  }
+  void flush()
+  {
+    if (pending) {
+      cache->access_batch(batch, pending);
+      pending = 0;
+    }
+  }
+
+  cache_sim_t* cache;
+  cache_hierarchy_t* hierarchy; // 用 hierarchy 的 spec 建立時才有，cache 是它的第一層
+  memtrace_writer_t* recorder;
+  cache_access_t batch[BATCH_SIZE]; // 每個 hart 的 I$ / D$ 各自有一個，攢滿了才一次送進 cache
+  size_t pending;
+  bool buffered;
+};
+
+class icache_sim_t : public cache_memtracer_t
+{
+ public:
+  icache_sim_t(const char* config) : cache_memtracer_t(config, "I$") {}
+  bool interested_in_range(uint64_t UNUSED begin, uint64_t UNUSED end, access_type type)
+  {
+    return type == FETCH;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    if (type == FETCH) {
+      if (unlikely(recorder != NULL)) recorder->write(addr, bytes, type);
+      push(addr, bytes, false);
+    }
+  }
+};
+
+class dcache_sim_t : public cache_memtracer_t
+{
+ public:
+  dcache_sim_t(const char* config) : cache_memtracer_t(config, "D$") {}
+  bool interested_in_range(uint64_t UNUSED begin, uint64_t UNUSED end, access_type type)
+  {
+    return type == LOAD || type == STORE;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    if (type == LOAD || type == STORE) {
+      if (unlikely(recorder != NULL)) recorder->write(addr, bytes, type);
+      push(addr, bytes, type == STORE);
+    }
+  }
+};
+
+#endif
+
+
@@ -0,0 +1,24 @@
+// See LICENSE for license details.
+
+// 跟 spike 的 riscv/common.h 一樣的 macro，給 tracesim 單獨編譯用
+
+#ifndef _RISCV_COMMON_H
+#define _RISCV_COMMON_H
+
+#ifdef __GNUC__
+# define   likely(x) __builtin_expect(x, 1)
+# define unlikely(x) __builtin_expect(x, 0)
+# define NOINLINE __attribute__ ((noinline))
+# define NORETURN __attribute__ ((noreturn))
+# define ALWAYS_INLINE __attribute__ ((always_inline))
+# define UNUSED __attribute__ ((unused))
+#else
+# define   likely(x) (x)
+# define unlikely(x) (x)
+# define NOINLINE
+# define NORETURN
+# define ALWAYS_INLINE
+# define UNUSED
+#endif
+
+#endif
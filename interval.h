@@ -0,0 +1,132 @@
+// See LICENSE for license details.
+
+// cache_sim_t 的 interval 統計 (config 的 interval=N)：每 N 次存取記一筆累計的計數，
+// 放進固定大小的 ring buffer，由另一條 thread 轉成 CSV 寫出去，存取的迴圈裡只多一個倒數
+// CSV 每一行是到那個時間點為止的累計值，最後一欄是這個 interval 自己的 miss rate
+// 檔名見 cache_stats_path()
+
+#ifndef _RISCV_INTERVAL_H
+#define _RISCV_INTERVAL_H
+
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// cache 的統計檔名：cache 的名字去掉英數字以外的字元 + suffix (D$ -> D.intervals.csv)，
+// 同一個名字的第二個 cache (例如 spike 第二個 hart 的 D$) 是 D.1.intervals.csv，依此類推
+static inline std::string cache_stats_path(const std::string& name, const char* suffix)
+{
+  static std::map<std::string, unsigned> instances;
+  std::string path;
+  for (char c : name)
+    if (isalnum((unsigned char)c))
+      path += c;
+  if (unsigned n = instances[path + suffix]++)
+    path += "." + std::to_string(n);
+  return path + suffix;
+}
+
+struct interval_sample_t
+{
+  uint64_t read_accesses;
+  uint64_t write_accesses;
+  uint64_t read_misses;
+  uint64_t write_misses;
+  uint64_t writebacks;
+};
+
+class interval_log_t
+{
+ public:
+  interval_log_t(const std::string& name)
+    : ring(RING), head(0), tail(0), done(false)
+  {
+    std::string path = cache_stats_path(name, ".intervals.csv");
+    f = fopen(path.c_str(), "w");
+    if (!f) {
+      std::cerr << "could not open " << path << std::endl;
+      exit(1);
+    }
+    fprintf(f, "accesses,read_accesses,write_accesses,read_misses,write_misses,writebacks,miss_rate\n");
+    prev = interval_sample_t();
+    writer = std::thread(&interval_log_t::run, this);
+  }
+
+  // 還沒寫出去的都寫完才關檔
+  ~interval_log_t()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      done = true;
+    }
+    cv.notify_all();
+    writer.join();
+    fclose(f);
+  }
+
+  // ring buffer 滿了就等 writer 寫掉一些，不會丟掉資料
+  void push(const interval_sample_t& s)
+  {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [this] { return head - tail < RING; });
+    ring[head++ % RING] = s;
+    lock.unlock();
+    cv.notify_all();
+  }
+
+ private:
+  static const size_t RING = 4096;
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mu);
+    for (;;) {
+      cv.wait(lock, [this] { return head != tail || done; });
+      if (head == tail)
+        break;
+
+      // 一次把現在有的都拿出來，寫檔的時候不拿著 lock
+      std::vector<interval_sample_t> pending;
+      for (; tail != head; tail++)
+        pending.push_back(ring[tail % RING]);
+      lock.unlock();
+      cv.notify_all();
+      for (const interval_sample_t& s : pending)
+        write_row(s);
+      lock.lock();
+    }
+  }
+
+  void write_row(const interval_sample_t& s)
+  {
+    uint64_t accesses = s.read_accesses + s.write_accesses;
+    uint64_t misses = s.read_misses + s.write_misses;
+    uint64_t d_accesses = accesses - (prev.read_accesses + prev.write_accesses);
+    uint64_t d_misses = misses - (prev.read_misses + prev.write_misses);
+    fprintf(f, "%llu,%llu,%llu,%llu,%llu,%llu,%.3f\n",
+            (unsigned long long)accesses, (unsigned long long)s.read_accesses,
+            (unsigned long long)s.write_accesses, (unsigned long long)s.read_misses,
+            (unsigned long long)s.write_misses, (unsigned long long)s.writebacks,
+            d_accesses ? 100.0 * d_misses / d_accesses : 0.0);
+    prev = s;
+  }
+
+  FILE* f;
+  std::vector<interval_sample_t> ring;
+  uint64_t head, tail; // 寫到第 head 筆、writer 拿到第 tail 筆
+  bool done;
+  std::mutex mu;
+  std::condition_variable cv;
+  std::thread writer;
+  interval_sample_t prev; // 上一筆，算這個 interval 的 miss rate (只有 writer 用)
+};
+
+#endif
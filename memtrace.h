@@ -0,0 +1,332 @@
+// See LICENSE for license details.
+
+// 二進位的 memory trace 格式，讓 benchmark 在 spike 上只要跑一次，之後用 tracesim 重播
+//
+//   file header  : magic "MTRC"、version、block 數、record 數 (關檔時才補上)
+//   block        : block header (payload 有幾個 byte、幾筆 record) + payload
+//   record       : 1 byte 的 info + zigzag LEB128 編碼的位址差
+//                  info bit 0-1 = access_type，bit 2-4 = log2(bytes)
+//                  bytes 不是 2 的次方 (或 > 64) 時 bit 2-4 = 7，後面再接一個 varint 存 bytes
+//                  位址差是跟「同一種 type 的上一筆」相減，fetch 幾乎都是 +2 / +4，只要 1 byte
+//                  每個 block 開頭都歸零，所以每個 block 可以單獨解碼
+//
+// header 直接照 host 的 byte order 寫 (x86 / RISC-V 都是 little endian)
+// 全部都寫在這個 .h 裡，spike 那邊不用改 riscv.mk.in 就能用
+
+#ifndef _RISCV_MEMTRACE_H
+#define _RISCV_MEMTRACE_H
+
+#include "memtracer.h"
+#include "common.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct memtrace_file_header_t
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t blocks;
+  uint64_t records;
+};
+
+struct memtrace_block_header_t
+{
+  uint32_t bytes;
+  uint32_t records;
+};
+
+// 解碼後的一筆存取
+struct memtrace_record_t
+{
+  uint64_t addr;
+  uint32_t bytes;
+  uint32_t type;
+};
+
+static const char MEMTRACE_MAGIC[4] = { 'M', 'T', 'R', 'C' };
+static const uint32_t MEMTRACE_VERSION = 1;
+static const uint32_t MEMTRACE_BLOCK_RECORDS = 1 << 16;
+static const unsigned MEMTRACE_SIZE_ESCAPE = 7;
+// 一筆 record 最長：info 1 byte + 位址差 10 bytes + bytes 10 bytes
+static const size_t MEMTRACE_MAX_RECORD_BYTES = 21;
+
+static inline uint8_t* memtrace_put_varint(uint8_t* p, uint64_t x)
+{
+  while (x >= 0x80) {
+    *p++ = uint8_t(x) | 0x80;
+    x >>= 7;
+  }
+  *p++ = uint8_t(x);
+  return p;
+}
+
+// 讀一個 varint，超出 end 或超過 10 bytes (trace 壞掉了) 回傳 NULL
+static inline const uint8_t* memtrace_get_varint(const uint8_t* p, const uint8_t* end, uint64_t* x)
+{
+  uint64_t v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (p == end)
+      return NULL;
+    uint8_t b = *p++;
+    v |= uint64_t(b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      *x = v;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+// 解一個 block 的 payload [p, end)，每一筆都呼叫 fn(addr, bytes, type)
+// 剛好用完整個 payload 解出 records 筆才回傳 true；record 超出 payload、type 不對都算壞掉
+template <class F>
+static inline bool memtrace_decode_block(const uint8_t* p, const uint8_t* end, uint32_t records, F fn)
+{
+  uint64_t prev[3] = { 0, 0, 0 };
+  for (uint32_t i = 0; i < records; i++) {
+    if (p == end)
+      return false;
+    uint8_t info = *p++;
+    unsigned type = info & 3;
+    unsigned size_code = (info >> 2) & 7;
+    uint64_t z, bytes;
+    if (type > FETCH || !(p = memtrace_get_varint(p, end, &z)))
+      return false;
+    if (size_code != MEMTRACE_SIZE_ESCAPE)
+      bytes = uint64_t(1) << size_code;
+    else if (!(p = memtrace_get_varint(p, end, &bytes)))
+      return false;
+    prev[type] += (z >> 1) ^ -(z & 1);
+    fn(prev[type], size_t(bytes), access_type(type));
+  }
+  return p == end;
+}
+
+class memtrace_writer_t
+{
+ public:
+  memtrace_writer_t(const char* path)
+    : block_len(0), block_records(0)
+  {
+    f = fopen(path, "wb");
+    if (!f) {
+      std::cerr << "could not open memory trace " << path << std::endl;
+      exit(1);
+    }
+    header.magic[0] = MEMTRACE_MAGIC[0];
+    header.magic[1] = MEMTRACE_MAGIC[1];
+    header.magic[2] = MEMTRACE_MAGIC[2];
+    header.magic[3] = MEMTRACE_MAGIC[3];
+    header.version = MEMTRACE_VERSION;
+    header.blocks = 0;
+    header.records = 0;
+    fwrite(&header, sizeof(header), 1, f);
+    block = new uint8_t[MEMTRACE_BLOCK_RECORDS * MEMTRACE_MAX_RECORD_BYTES];
+    reset_block();
+  }
+
+  // 把最後一個 block 寫出去，再回頭補 header 的 block 數 / record 數
+  ~memtrace_writer_t()
+  {
+    flush();
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
+    fclose(f);
+    delete [] block;
+  }
+
+  void write(uint64_t addr, size_t bytes, access_type type)
+  {
+    unsigned size_code = MEMTRACE_SIZE_ESCAPE;
+    if (bytes && bytes <= 64 && !(bytes & (bytes-1)))
+      size_code = __builtin_ctzll(bytes);
+
+    int64_t delta = int64_t(addr - prev[type]);
+    prev[type] = addr;
+
+    uint8_t* p = block + block_len;
+    *p++ = uint8_t(type | (size_code << 2));
+    p = memtrace_put_varint(p, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+    if (size_code == MEMTRACE_SIZE_ESCAPE)
+      p = memtrace_put_varint(p, bytes);
+    block_len = p - block;
+
+    if (++block_records == MEMTRACE_BLOCK_RECORDS)
+      flush();
+  }
+
+  // spike 那邊 I$ / D$ 各有一個 cache_memtracer_t，共用同一個 writer 才不會把同一筆存取錄兩次
+  // 環境變數 CACHESIM_TRACE 有設定時才會錄，沒設定就回傳 NULL
+  static memtrace_writer_t* acquire_shared()
+  {
+    const char* path = getenv("CACHESIM_TRACE");
+    if (!path || !*path)
+      return NULL;
+    if (shared_refs()++ == 0)
+      shared() = new memtrace_writer_t(path);
+    return shared();
+  }
+
+  static void release_shared()
+  {
+    if (--shared_refs() == 0) {
+      delete shared();
+      shared() = NULL;
+    }
+  }
+
+ private:
+  void reset_block()
+  {
+    block_len = 0;
+    block_records = 0;
+    prev[LOAD] = prev[STORE] = prev[FETCH] = 0;
+  }
+
+  void flush()
+  {
+    if (block_records == 0)
+      return;
+    memtrace_block_header_t bh = { uint32_t(block_len), block_records };
+    fwrite(&bh, sizeof(bh), 1, f);
+    fwrite(block, 1, block_len, f);
+    header.blocks++;
+    header.records += block_records;
+    reset_block();
+  }
+
+  static memtrace_writer_t*& shared() { static memtrace_writer_t* w = NULL; return w; }
+  static unsigned& shared_refs() { static unsigned n = 0; return n; }
+
+  FILE* f;
+  memtrace_file_header_t header;
+  uint8_t* block;
+  size_t block_len;
+  uint32_t block_records;
+  uint64_t prev[3];
+};
+
+// 用 mmap 讀二進位 trace，每次把一整個 block 解碼成 memtrace_record_t 陣列
+// 不經過 iostream，也不用每筆 read()；讀過的部分會 MADV_DONTNEED 掉，幾 GB 的 trace 也不會一直佔著記憶體
+class memtrace_reader_t
+{
+ public:
+  memtrace_reader_t(const char* path)
+  {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      std::cerr << "could not open memory trace " << path << std::endl;
+      exit(1);
+    }
+    size = st.st_size;
+    if (size < sizeof(memtrace_file_header_t))
+      bad_trace(path);
+
+    void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      std::cerr << "could not mmap memory trace " << path << std::endl;
+      exit(1);
+    }
+    base = (const uint8_t*)p;
+    madvise(p, size, MADV_SEQUENTIAL);
+
+    header = (const memtrace_file_header_t*)base;
+    if (memcmp(header->magic, MEMTRACE_MAGIC, sizeof(MEMTRACE_MAGIC)) != 0 ||
+        header->version != MEMTRACE_VERSION)
+      bad_trace(path);
+    pos = sizeof(memtrace_file_header_t);
+    released = 0;
+    this->path = path;
+  }
+
+  ~memtrace_reader_t()
+  {
+    munmap((void*)base, size);
+  }
+
+  uint64_t records() const { return header->records; }
+
+  // 把下一個 block 解碼到 buf (至少要有 MEMTRACE_BLOCK_RECORDS 格)，回傳筆數，讀完了回傳 0
+  size_t next_batch(memtrace_record_t* buf)
+  {
+    if (pos + sizeof(memtrace_block_header_t) > size)
+      return 0;
+    memtrace_block_header_t bh;
+    memcpy(&bh, base + pos, sizeof(bh));
+    pos += sizeof(bh);
+    if (bh.records > MEMTRACE_BLOCK_RECORDS || bh.bytes > size - pos)
+      bad_trace(path);
+
+    memtrace_record_t* out = buf;
+    bool ok = memtrace_decode_block(base + pos, base + pos + bh.bytes, bh.records,
+      [&out](uint64_t addr, size_t bytes, access_type type) {
+        out->addr = addr;
+        out->bytes = uint32_t(bytes);
+        out->type = type;
+        out++;
+      });
+    if (!ok)
+      bad_trace(path);
+    pos += bh.bytes;
+    release_consumed();
+    return bh.records;
+  }
+
+ private:
+  static const size_t RELEASE_CHUNK = 64 << 20;
+
+  // 已經解碼完的頁面不會再用到，每 64MB 還給 kernel 一次
+  void release_consumed()
+  {
+    size_t done = pos & ~(RELEASE_CHUNK - 1);
+    if (done > released) {
+      madvise((void*)(base + released), done - released, MADV_DONTNEED);
+      released = done;
+    }
+  }
+
+  static void bad_trace(const char* path)
+  {
+    std::cerr << path << ": not a valid memory trace" << std::endl;
+    exit(1);
+  }
+
+  const uint8_t* base;
+  const memtrace_file_header_t* header;
+  size_t size;
+  size_t pos;
+  size_t released;
+  const char* path;
+};
+
+// 把看到的每一筆 FETCH / LOAD / STORE 都錄下來的 memtracer
+class memtrace_recorder_t : public memtracer_t
+{
+ public:
+  memtrace_recorder_t(const char* path) : writer(path) {}
+  bool interested_in_range(uint64_t UNUSED begin, uint64_t UNUSED end, access_type UNUSED type)
+  {
+    return true;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    writer.write(addr, bytes, type);
+  }
+  void clean_invalidate(uint64_t UNUSED addr, size_t UNUSED bytes, bool UNUSED clean, bool UNUSED inval)
+  {
+  }
+
+ private:
+  memtrace_writer_t writer;
+};
+
+#endif
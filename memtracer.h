@@ -0,0 +1,60 @@
+// See LICENSE for license details.
+
+// 跟 spike 的 riscv/memtracer.h 介面一樣，只留 cache_sim_t 會用到的部分
+// 讓 cachesim.cc 不用整個 spike tree 也能編譯 (tracesim)
+// make install 只會複製 cachesim.cc/.h 過去，spike 裡面還是用它自己的版本
+
+#ifndef _MEMTRACER_H
+#define _MEMTRACER_H
+
+#include <cstdint>
+#include <string.h>
+#include <vector>
+
+enum access_type {
+  LOAD,
+  STORE,
+  FETCH,
+};
+
+class memtracer_t
+{
+ public:
+  memtracer_t() {}
+  virtual ~memtracer_t() {}
+
+  virtual bool interested_in_range(uint64_t begin, uint64_t end, access_type type) = 0;
+  virtual void trace(uint64_t addr, size_t bytes, access_type type) = 0;
+  virtual void clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool inval) = 0;
+};
+
+class memtracer_list_t : public memtracer_t
+{
+ public:
+  bool empty() { return list.empty(); }
+  bool interested_in_range(uint64_t begin, uint64_t end, access_type type)
+  {
+    for (auto it: list)
+      if (it->interested_in_range(begin, end, type))
+        return true;
+    return false;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    for (auto it: list)
+      it->trace(addr, bytes, type);
+  }
+  void clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool inval)
+  {
+    for (auto it: list)
+      it->clean_invalidate(addr, bytes, clean, inval);
+  }
+  void hook(memtracer_t* h)
+  {
+    list.push_back(h);
+  }
+ private:
+  std::vector<memtracer_t*> list;
+};
+
+#endif
@@ -0,0 +1,188 @@
+// See LICENSE for license details.
+
+// cache_sim_t 的硬體 prefetcher，config 的 pf=next / stride / stream 選一個
+// 每次 demand 存取 cache 都會把 line address 交給 observe()，prefetcher 回傳要先抓進來的 line
+// 抓進來的 line 跟 demand miss 一樣走 victimize() 和 miss handler (見 cachesim.cc 的 prefetch_impl)
+//
+// prefetcher 要提供：
+//   prefetcher_t(opts, idx_shift)   opts 是 config 的 key=value 選項，用 take_option() 拿自己的
+//   size_t observe(uint64_t line, bool miss, bool pf_hit, uint64_t* out)
+//     line 是這次存取的 line address，miss 是 demand miss，pf_hit 是第一次用到 prefetch 進來的 line
+//     要 prefetch 的 line 放進 out (最多 MAX_LINES 個)，回傳個數
+
+#ifndef _RISCV_PREFETCH_H
+#define _RISCV_PREFETCH_H
+
+#include "cachesim.h"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+class prefetcher_t
+{
+ public:
+  static const size_t MAX_LINES = 64;
+
+  virtual ~prefetcher_t() {}
+  virtual size_t observe(uint64_t line, bool miss, bool pf_hit, uint64_t* out) = 0;
+
+ protected:
+  // pfdegree / pfdepth 一次最多抓 MAX_LINES 條
+  static size_t take_count(cache_options_t& opts, const char* key, size_t def)
+  {
+    size_t n = take_option(opts, key, def);
+    if (n == 0 || n > MAX_LINES) {
+      std::cerr << key << " must be between 1 and " << MAX_LINES << std::endl;
+      exit(1);
+    }
+    return n;
+  }
+
+  // line + delta 沒有繞過 0 或 2^64 才放進 out
+  static size_t push(uint64_t* out, size_t n, uint64_t line, int64_t delta)
+  {
+    uint64_t target = line + delta;
+    if ((delta > 0 && target > line) || (delta < 0 && target < line))
+      out[n++] = target;
+    return n;
+  }
+};
+
+// next-line：miss 或第一次用到 prefetch 進來的 line (tagged prefetch) 時抓後面 pfdegree 條
+class next_line_prefetcher_t : public prefetcher_t
+{
+ public:
+  next_line_prefetcher_t(cache_options_t& opts, size_t UNUSED idx_shift)
+    : degree(take_count(opts, "pfdegree", 1)) {}
+
+  size_t observe(uint64_t line, bool miss, bool pf_hit, uint64_t* out)
+  {
+    size_t n = 0;
+    if (miss || pf_hit)
+      for (size_t k = 1; k <= degree; k++)
+        n = push(out, n, line, k);
+    return n;
+  }
+
+ private:
+  size_t degree;
+};
+
+// stride (reference prediction table)：trace 裡沒有 PC，改成用 4 KB 的 region 當 table 的 key
+// 同一個 region 裡連續兩次的間隔一樣就有信心，信心夠了就抓 line + stride * 1..pfdegree
+class stride_prefetcher_t : public prefetcher_t
+{
+ public:
+  stride_prefetcher_t(cache_options_t& opts, size_t idx_shift)
+    : degree(take_count(opts, "pfdegree", 1)), region_shift(idx_shift < 12 ? 12 - idx_shift : 0),
+      table(ENTRIES) {}
+
+  size_t observe(uint64_t line, bool UNUSED miss, bool UNUSED pf_hit, uint64_t* out)
+  {
+    uint64_t region = line >> region_shift;
+    entry_t& e = table[region % ENTRIES];
+    if (!e.valid || e.region != region) {
+      e.valid = true;
+      e.region = region;
+      e.last = line;
+      e.stride = 0;
+      e.conf = 0;
+      return 0;
+    }
+
+    int64_t delta = int64_t(line - e.last);
+    if (delta == 0)
+      return 0;
+    if (delta == e.stride) {
+      if (e.conf < MAX_CONF)
+        e.conf++;
+    } else if (e.conf) {
+      e.conf--;
+    } else {
+      e.stride = delta;
+    }
+    e.last = line;
+
+    size_t n = 0;
+    if (e.conf >= 2)
+      for (size_t k = 1; k <= degree; k++)
+        n = push(out, n, line, e.stride * int64_t(k));
+    return n;
+  }
+
+ private:
+  static const size_t ENTRIES = 64;
+  static const int MAX_CONF = 3;
+
+  struct entry_t
+  {
+    bool valid;
+    uint64_t region;
+    uint64_t last; // 這個 region 上一次存取的 line
+    int64_t stride;
+    int conf; // 0..MAX_CONF
+  };
+
+  size_t degree;
+  size_t region_shift;
+  std::vector<entry_t> table;
+};
+
+// stream：miss 時開一條往上走的 stream，先抓 line + 1..pfdepth，
+// 之後每用到一條這條 stream 抓進來的 line 就再往前抓一條，一直保持 pfdepth 條在前面
+// 最多同時追 STREAMS 條 stream，要開新的就換掉最久沒前進的那條
+class stream_prefetcher_t : public prefetcher_t
+{
+ public:
+  stream_prefetcher_t(cache_options_t& opts, size_t UNUSED idx_shift)
+    : depth(take_count(opts, "pfdepth", 4)), streams(STREAMS), clock(0) {}
+
+  size_t observe(uint64_t line, bool miss, bool pf_hit, uint64_t* out)
+  {
+    if (!miss && !pf_hit)
+      return 0;
+
+    // 落在某條 stream 已經抓過的範圍裡 (next - depth .. next - 1) 就往前推一條
+    for (stream_t& s : streams)
+      if (s.valid && line < s.next && line + depth >= s.next) {
+        s.used = ++clock;
+        size_t n = push(out, 0, s.next - 1, 1);
+        s.next += n;
+        return n;
+      }
+    if (!miss)
+      return 0;
+
+    stream_t* victim = &streams[0];
+    for (stream_t& s : streams)
+      if (!s.valid || s.used < victim->used) {
+        victim = &s;
+        if (!s.valid)
+          break;
+      }
+    victim->valid = true;
+    victim->used = ++clock;
+    size_t n = 0;
+    for (size_t k = 1; k <= depth; k++)
+      n = push(out, n, line, k);
+    victim->next = line + n + 1;
+    return n;
+  }
+
+ private:
+  static const size_t STREAMS = 4;
+
+  struct stream_t
+  {
+    bool valid;
+    uint64_t next; // 下一條要抓的 line
+    uint64_t used;
+  };
+
+  size_t depth;
+  std::vector<stream_t> streams;
+  uint64_t clock;
+};
+
+#endif
@@ -0,0 +1,208 @@
+// See LICENSE for license details.
+
+// LRU 的 stack distance (Mattson) 分析
+// LRU 有 inclusion property：同一個 (sets, blocksize) 底下，ways 比較少的 cache 內容一定是 ways 比較多的子集合
+// 所以每個 set 只要維護一條依照最近使用排序的 stack，看這次存取的 line 在 stack 裡的深度 d，
+// 就知道所有 ways > d 的 LRU cache 都會 hit，一次走過 trace 就得到每一種 ways 的 miss 數
+
+#ifndef _RISCV_STACKDIST_H
+#define _RISCV_STACKDIST_H
+
+#include "memtracer.h"
+#include "common.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class lru_stack_t
+{
+ public:
+  // max_ways 是最多要算到幾個 way，stack 只需要留這麼深
+  lru_stack_t(size_t sets, size_t max_ways, size_t linesz)
+    : sets(sets), max_ways(max_ways), stack(sets*max_ways, 0), hits(max_ways, 0), n(0)
+  {
+    idx_shift = 0;
+    for (size_t x = linesz; x > 1; x >>= 1)
+      idx_shift++;
+  }
+
+  void access(uint64_t addr)
+  {
+    uint64_t line = (addr >> idx_shift) | VALID;
+    uint64_t* s = &stack[((addr >> idx_shift) & (sets-1)) * max_ways];
+    n++;
+
+    // 找到就記下深度，沒找到就當作在最底下 (所有 ways 都 miss)
+    size_t d = 0;
+    while (d < max_ways && s[d] != line)
+      d++;
+    if (d < max_ways)
+      hits[d]++;
+    else
+      d = max_ways - 1;
+
+    // 把這條 line 搬到 stack 最上面
+    memmove(s + 1, s, d * sizeof(uint64_t));
+    s[0] = line;
+  }
+
+  uint64_t accesses() const { return n; }
+
+  // ways 個 way 的 LRU cache 的 miss 數 = 深度 >= ways 的存取數
+  uint64_t misses(size_t ways) const
+  {
+    uint64_t m = n;
+    for (size_t d = 0; d < ways && d < max_ways; d++)
+      m -= hits[d];
+    return m;
+  }
+
+ private:
+  static const uint64_t VALID = 1ULL << 63;
+
+  size_t sets;
+  size_t max_ways;
+  size_t idx_shift;
+  std::vector<uint64_t> stack; // 每個 set 有 max_ways 格，[0] 是最近用到的
+  std::vector<uint64_t> hits; // hits[d] = 在深度 d 被找到的次數
+  uint64_t n;
+};
+
+// bf.sh 的掃法：總容量固定 capacity bytes，blocksize 從 8 到 capacity，sets 從 1 到 capacity / blocksize
+// 每一組 (blocksize, sets) 一條 lru_stack_t，只看 LOAD / STORE (跟 dcache_sim_t 一樣)
+class lru_sweep_t : public memtracer_t
+{
+ public:
+  struct point_t
+  {
+    size_t sets, ways, linesz;
+  };
+
+  lru_sweep_t(size_t capacity)
+  {
+    for (size_t linesz = 8; linesz <= capacity; linesz *= 2)
+      for (size_t sets = 1; sets * linesz <= capacity; sets *= 2) {
+        point_t p = { sets, capacity / (sets * linesz), linesz };
+        points.push_back(p);
+        stacks.push_back(lru_stack_t(p.sets, p.ways, p.linesz));
+      }
+  }
+
+  bool interested_in_range(uint64_t UNUSED begin, uint64_t UNUSED end, access_type type)
+  {
+    return type == LOAD || type == STORE;
+  }
+  void trace(uint64_t addr, size_t UNUSED bytes, access_type type)
+  {
+    if (type == LOAD || type == STORE)
+      for (auto& s : stacks)
+        s.access(addr);
+  }
+  void clean_invalidate(uint64_t UNUSED addr, size_t UNUSED bytes, bool UNUSED clean, bool UNUSED inval)
+  {
+  }
+
+  size_t size() const { return points.size(); }
+  const point_t& point(size_t i) const { return points[i]; }
+  const lru_stack_t& stack(size_t i) const { return stacks[i]; }
+
+ private:
+  std::vector<point_t> points;
+  std::vector<lru_stack_t> stacks;
+};
+
+// 一條 cache_sim_t 的存取串流的 reuse distance (= 上次用到這條 line 之後又用過幾條不同的 line)
+// 每條 line 記最後一次存取的時間，Fenwick tree 在每條 line 最後一次存取的時間點放 1，
+// 兩次存取中間有幾個 1 就是 reuse distance，一次存取 O(log n)
+// 時間用完就把還活著的 line 依序重新編號 (compact)，tree 的大小跟不同的 line 數成正比
+// sample > 1 時照 SHARDS 的做法只看 hash(line) % sample == 0 的 line，量到的距離和次數都乘上 sample
+// last 每條抽到的 line 留一個 entry，不會刪掉：記憶體跟 trace 的 footprint (不同的 line 數 / sample) 一起長
+class reuse_profiler_t
+{
+ public:
+  static const size_t BUCKETS = 65; // [0] 是距離 0，[k] 是 [2^(k-1), 2^k)
+
+  reuse_profiler_t(size_t sample) : sample(sample ? sample : 1), now(0), cold_refs(0), hist(BUCKETS, 0)
+  {
+    tree.assign(MIN_SIZE + 1, 0);
+  }
+
+  void access(uint64_t line)
+  {
+    // 沒抽到的 line 先用 hash 丟掉，不查 last 也不放進 last
+    if (!sampled(line))
+      return;
+    if (now == tree.size() - 1)
+      compact();
+
+    auto it = last.find(line);
+    if (it == last.end()) {
+      cold_refs++;
+      last.emplace(line, now);
+    } else {
+      uint64_t d = prefix(now) - prefix(it->second + 1);
+      add(it->second, -1);
+      hist[bucket(d * sample)]++;
+      it->second = now;
+    }
+    add(now, 1);
+    now++;
+  }
+
+  size_t scale() const { return sample; }
+  uint64_t cold() const { return cold_refs; } // 第一次看到的 line (距離無限大)
+  const std::vector<uint64_t>& histogram() const { return hist; }
+
+ private:
+  static const size_t MIN_SIZE = 1024;
+
+  bool sampled(uint64_t line) const
+  {
+    return sample == 1 || ((line * 0x9e3779b97f4a7c15ULL) >> 40) % sample == 0;
+  }
+
+  static size_t bucket(uint64_t d) { return d ? 64 - __builtin_clzll(d) : 0; }
+
+  // Fenwick tree，位置 i 存在 tree[i + 1]
+  void add(uint64_t i, int32_t v)
+  {
+    for (i++; i < tree.size(); i += i & -i)
+      tree[i] += v;
+  }
+  uint64_t prefix(uint64_t i) const // [0, i) 的和
+  {
+    uint64_t sum = 0;
+    for (; i; i -= i & -i)
+      sum += tree[i];
+    return sum;
+  }
+
+  // 依照最後一次存取的先後把 line 重新編號成 0..n-1，tree 留 n 的四倍
+  void compact()
+  {
+    std::vector<std::pair<uint64_t, uint64_t>> order;
+    order.reserve(last.size());
+    for (const auto& e : last)
+      order.push_back(std::make_pair(e.second, e.first));
+    std::sort(order.begin(), order.end());
+
+    size_t min_size = MIN_SIZE; // std::max 拿的是 reference，不能直接把 MIN_SIZE 傳進去
+    tree.assign(std::max(min_size, 4 * order.size()) + 1, 0);
+    for (now = 0; now < order.size(); now++) {
+      last[order[now].second] = now;
+      add(now, 1);
+    }
+  }
+
+  size_t sample;
+  uint64_t now; // 下一次存取的時間
+  uint64_t cold_refs;
+  std::unordered_map<uint64_t, uint64_t> last; // line -> 最後一次存取的時間
+  std::vector<int32_t> tree;
+  std::vector<uint64_t> hist;
+};
+
+#endif
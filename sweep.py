@@ -0,0 +1,96 @@
+import argparse
+import concurrent.futures
+import glob
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# 平行版的 bf.sh：每個 benchmark 只編譯一次，所有 (set, way, block) 組合丟給 worker pool 一起跑
+# 每個 job 的輸出各自收在自己的 buffer，最後照 bf.sh 的順序合併成 outputXXX.txt
+
+PK_PATH = "/home/ubuntu/riscv/riscv64-unknown-elf/bin/pk"
+SEPARATOR = "======================================================================="
+
+
+def sweep_points(capacity_log2):
+    # 跟 bf.sh 一樣：block 從 2^3 到 2^capacity_log2，set 從 2^0 到 2^(capacity_log2-block)
+    points = []
+    for block in range(3, capacity_log2 + 1):
+        for set_ in range(0, capacity_log2 - block + 1):
+            way = capacity_log2 - set_ - block
+            points.append((2 ** set_, 2 ** way, 2 ** block))
+    return points
+
+
+def compile_benchmarks(workdir):
+    binaries = []
+    for src in sorted(glob.glob("./benchmark/*.c")):
+        name = os.path.splitext(os.path.basename(src))[0]
+        binary = os.path.join(workdir, name + ".elf")
+        subprocess.run(["riscv64-unknown-elf-gcc", "-march=rv64gc", "-static", "-o", binary, src], check=True)
+        binaries.append(binary)
+    return binaries
+
+
+def dcache_miss_rate(output):
+    for line in output.split("\n"):
+        if line.startswith("D$ Miss Rate:"):
+            return float(line.split()[3].split('%')[0])
+    raise RuntimeError("no D$ miss rate in simulator output:\n" + output)
+
+
+def run_spike(point, binary, policy, pk_path):
+    config = "%d:%d:%d:%s" % (point + (policy,))
+    output = subprocess.run(["spike", "--dc=" + config, "--isa=RV64GC", pk_path, binary],
+                            capture_output=True, text=True, check=True)
+    return dcache_miss_rate(output.stdout)
+
+
+def run_tracesim(point, trace, policy):
+    config = "%d:%d:%d:%s" % (point + (policy,))
+    output = subprocess.run(["./tracesim", "--dc=" + config, trace],
+                            capture_output=True, text=True, check=True)
+    return dcache_miss_rate(output.stdout)
+
+
+def format_point(point, miss_rate):
+    # 跟 test.py 印的一樣，bf.sh 只留下 ==== 後面三行
+    return "%s\nData Cache Setting with: %d:%d:%d\nMiss Rate: %s %%\n" % (
+        (SEPARATOR,) + point + (str(round(miss_rate, 4)),))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Sweep every (set, way, block) point of a fixed-size D$ in parallel.")
+    parser.add_argument("policy", help="replacement policy (origin, fifo, lru, lfu, self, srrip, brrip, drrip, plru, bitplru, arc)")
+    parser.add_argument("--capacity-log2", type=int, default=6, help="log2 of the D$ size in bytes (default 6)")
+    parser.add_argument("--jobs", "-j", type=int, default=os.cpu_count(), help="number of workers (default: all cores)")
+    parser.add_argument("--traces", help="replay <dir>/*.mtr with tracesim instead of running spike")
+    parser.add_argument("--pk", default=PK_PATH, help="path to pk")
+    args = parser.parse_args()
+
+    points = sweep_points(args.capacity_log2)
+    workdir = tempfile.mkdtemp(prefix="sweep-")
+    try:
+        if args.traces:
+            if subprocess.run(["make", "sim"]).returncode != 0:
+                sys.exit(1)
+            inputs = sorted(glob.glob(os.path.join(args.traces, "*.mtr")))
+            if not inputs:
+                sys.exit("no traces in " + args.traces)
+            run = lambda point, trace: run_tracesim(point, trace, args.policy)
+        else:
+            inputs = compile_benchmarks(workdir)
+            run = lambda point, binary: run_spike(point, binary, args.policy, args.pk)
+
+        # 每個 (point, benchmark) 都是一個 job，結果放在各自的位置，不會互相搶 output
+        with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+            futures = [[pool.submit(run, point, i) for i in inputs] for point in points]
+            miss_rates = [sum(f.result() for f in row) / len(inputs) for row in futures]
+    finally:
+        shutil.rmtree(workdir)
+
+    with open("output" + args.policy + ".txt", "w") as out:
+        for point, miss_rate in zip(points, miss_rates):
+            out.write(format_point(point, miss_rate))
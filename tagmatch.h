@@ -0,0 +1,93 @@
+// See LICENSE for license details.
+
+// 在一個 set 的 32-bit tag 陣列裡找 tag 的 kernel，回傳第一個相符的 way，都不相符就回傳 ways
+// x86 上執行時用 CPUID 挑 AVX2 (一次比 8 個 way) 或 SSE4.2 (一次比 4 個 way)，其他機器用一般的迴圈
+// 不需要額外的編譯參數，SIMD 的版本用 target attribute 各自編
+// 加了 target attribute 的 function 不能 inline 進一般的 function，所以 way 數是編譯時的常數時
+// 改用 tag_match_inline()：x86-64 一定有 SSE2，不用 target attribute，整個 inline 進 cache_core_t 的 find()
+
+#ifndef _RISCV_TAG_MATCH_H
+#define _RISCV_TAG_MATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAG_MATCH_X86 1
+#endif
+
+typedef size_t (*tag_match_fn_t)(const uint32_t* tags, size_t ways, uint32_t tag);
+
+static inline size_t tag_match_scalar(const uint32_t* tags, size_t ways, uint32_t tag)
+{
+  for (size_t i = 0; i < ways; i++)
+    if (tags[i] == tag)
+      return i;
+  return ways;
+}
+
+#ifdef TAG_MATCH_X86
+__attribute__((target("sse4.2")))
+static inline size_t tag_match_sse42(const uint32_t* tags, size_t ways, uint32_t tag)
+{
+  const __m128i t = _mm_set1_epi32(tag);
+  size_t i = 0;
+  for (; i + 4 <= ways; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(tags + i));
+    int hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, t)));
+    if (hit)
+      return i + __builtin_ctz(hit);
+  }
+  return i + tag_match_scalar(tags + i, ways - i, tag);
+}
+
+__attribute__((target("avx2")))
+static inline size_t tag_match_avx2(const uint32_t* tags, size_t ways, uint32_t tag)
+{
+  const __m256i t = _mm256_set1_epi32(tag);
+  size_t i = 0;
+  for (; i + 8 <= ways; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(tags + i));
+    int hit = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, t)));
+    if (hit)
+      return i + __builtin_ctz(hit);
+  }
+  return i + tag_match_scalar(tags + i, ways - i, tag);
+}
+#endif
+
+#ifdef __SSE2__
+static inline size_t tag_match_inline(const uint32_t* tags, size_t ways, uint32_t tag)
+{
+  const __m128i t = _mm_set1_epi32(tag);
+  size_t i = 0;
+  for (; i + 4 <= ways; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(tags + i));
+    int hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, t)));
+    if (hit)
+      return i + __builtin_ctz(hit);
+  }
+  return i + tag_match_scalar(tags + i, ways - i, tag);
+}
+#else
+static inline size_t tag_match_inline(const uint32_t* tags, size_t ways, uint32_t tag)
+{
+  return tag_match_scalar(tags, ways, tag);
+}
+#endif
+
+// 依照這台機器支援的指令集挑一個 kernel
+static inline tag_match_fn_t select_tag_match()
+{
+#ifdef TAG_MATCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return tag_match_avx2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return tag_match_sse42;
+#endif
+  return tag_match_scalar;
+}
+
+#endif
@@ -9,10 +9,10 @@ if __name__ == "__main__":
     cache_set =  config['cache']['Set']
     cache_way =  config['cache']['Way']
     cache_block_size = config['cache']['BlockSize']
-    policy = config['cache']['Policy']
+    policy = config['cache']['Policy'].strip('"')
     
     if (sys.argv[1] == "build"):
-        os.system("make " + policy)
+        os.system("make install")
     elif (sys.argv[1] != "test"):
         print("wrong argument")
         exit(0)
@@ -25,7 +25,7 @@ if __name__ == "__main__":
 
     for benchmark in benchmarks:
         os.system("make compile FILE_NAME=./benchmark/" + benchmark)
-        output = subprocess.run(["make", "run", "CACHE_SET=" + cache_set, "CACHE_WAY=" + cache_way, "CACHE_BLOCKSIZE=" + cache_block_size], capture_output=True, text=True)
+        output = subprocess.run(["make", "run", "CACHE_SET=" + cache_set, "CACHE_WAY=" + cache_way, "CACHE_BLOCKSIZE=" + cache_block_size, "CACHE_POLICY=" + policy], capture_output=True, text=True)
         lines = output.stdout.split("\n")
         avg_miss_rate += float(lines[-2].split()[3].split('%')[0])
 
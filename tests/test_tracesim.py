@@ -0,0 +1,248 @@
+import os
+import struct
+import subprocess
+import tempfile
+import unittest
+
+# tracesim 的回歸測試：make check (要先 make sim)
+# trace 都是寫在這裡的文字 trace，從 stdin 餵進去
+
+TRACESIM = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tracesim")
+
+
+def run(args, trace):
+    return subprocess.run([TRACESIM] + args + ["-"], input=trace, capture_output=True, text=True)
+
+
+def dcache_misses(config, trace):
+    output = run(["--dc=" + config], trace)
+    if output.returncode != 0:
+        raise RuntimeError(output.stderr)
+    misses = 0
+    for line in output.stdout.split("\n"):
+        if line.startswith("D$ Read Misses:") or line.startswith("D$ Write Misses:"):
+            misses += int(line.split()[-1])
+    return misses
+
+
+def stats(args, trace):
+    # 統計資料的每一行是 "名字: 數值"，回傳 {名字: 數值字串}
+    output = run(args, trace)
+    if output.returncode != 0:
+        raise RuntimeError(output.stderr)
+    result = {}
+    for line in output.stdout.split("\n"):
+        if ":" in line:
+            key, value = line.split(":", 1)
+            result[key.strip()] = value.split()[0]
+    return result
+
+
+class hierarchy_test(unittest.TestCase):
+    # L1D 2 個 way、L2 4 個 way，都只有 1 個 set：
+    # L1D 每次都 miss，最後讀 0 的時候把寫過的 18 換掉寫回 L2；L2 只有第一次用到 0、8、10、18 會 miss
+    def test_two_levels(self):
+        trace = "0 8 L\n8 8 L\n10 8 L\n0 8 L\n18 8 S\n8 8 L\n0 8 L\n"
+        result = stats(["--dc=L1D=1:2:8:lru,L2=1:4:8:lru,mem=100"], trace)
+        self.assertEqual(result["L1D Read Misses"], "6")
+        self.assertEqual(result["L1D Write Misses"], "1")
+        self.assertEqual(result["L1D Writebacks"], "1")
+        self.assertEqual(result["L2 Read Accesses"], "7")
+        self.assertEqual(result["L2 Write Accesses"], "1")
+        self.assertEqual(result["L2 Read Misses"], "4")
+        self.assertEqual(result["L2 Write Misses"], "0")
+        # L2：12 + 0.5 * 100，L1D：4 + 1.0 * 62
+        self.assertEqual(result["L1D AMAT"], "66.000")
+
+
+class inclusion_test(unittest.TestCase):
+    # L1D 和 L2 都是 1 個 set 2 個 way：讀 0、8、0 之後 L2 的 LRU 是 0 (L1D hit 的那次 L2 看不到)
+    # 讀 10 的時候 L2 換掉 0
+    TRACE = "0 8 L\n8 8 L\n0 8 L\n10 8 L\n0 8 L\n"
+
+    def levels(self, incl, trace):
+        return stats(["--dc=L1D=1:2:8:lru,L2=1:2:8:lru:incl=" + incl + ",mem=100"], trace)
+
+    def test_nine(self):
+        # L2 換掉 0 不影響 L1D，最後讀 0 還是 hit
+        result = self.levels("nine", self.TRACE)
+        self.assertEqual(result["L1D Read Misses"], "3")
+        self.assertNotIn("L1D Back-invalidations", result)
+
+    def test_inclusive(self):
+        # L2 換掉 0 的時候把 L1D 的 0 也清掉，最後讀 0 變成 miss
+        result = self.levels("inclusive", self.TRACE)
+        self.assertEqual(result["L1D Back-invalidations"], "1")
+        self.assertEqual(result["L1D Read Misses"], "4")
+        self.assertEqual(result["L2 Read Misses"], "4")
+
+    def test_exclusive(self):
+        # L1D 換掉的 8、10 都放進 L2；再讀 8 是從 L2 搬上來，L2 不算 miss
+        result = self.levels("exclusive", self.TRACE + "8 8 L\n")
+        self.assertEqual(result["L2 Victim Fills"], "2")
+        self.assertEqual(result["L1D Read Misses"], "4")
+        self.assertEqual(result["L2 Read Accesses"], "4")
+        self.assertEqual(result["L2 Read Misses"], "3")
+
+
+class victim_cache_test(unittest.TestCase):
+    # direct-mapped，0 和 10 搶同一個 set：沒有 victim cache 每次都 miss
+    # vc=1 的時候兩條 line 在 cache 和 victim cache 之間對調，只有第一次算 miss
+    # 20 把寫過的 0 擠進 victim cache，30 再把它擠出來寫回去
+    def test_swap_hits(self):
+        trace = "0 8 L\n10 8 L\n0 8 L\n10 8 L\n0 8 S\n10 8 L\n0 8 L\n20 8 L\n30 8 L\n"
+        self.assertEqual(dcache_misses("2:1:8:lru", trace), 9)
+        result = stats(["--dc=2:1:8:lru:vc=1"], trace)
+        self.assertEqual(result["D$ Swap Hits"], "5")
+        self.assertEqual(result["D$ Read Misses"], "4")
+        self.assertEqual(result["D$ Write Misses"], "0")
+        self.assertEqual(result["D$ Writebacks"], "1")
+
+
+class prefetch_test(unittest.TestCase):
+    # 1 個 set 16 個 way，8 次存取都放得下，不會有 prefetch 把 line 擠掉
+    def sequential(self, stride):
+        return "".join("%x 8 L\n" % (8 * stride * i) for i in range(8))
+
+    def test_next_line(self):
+        # 只有第一次 miss，之後每條 line 都是前一次 prefetch 進來的；最後一條 prefetch 的沒用到
+        result = stats(["--dc=1:16:8:lru:pf=next"], self.sequential(1))
+        self.assertEqual(result["D$ Read Misses"], "1")
+        self.assertEqual(result["D$ Prefetches"], "8")
+        self.assertEqual(result["D$ Useful Prefetches"], "7")
+        self.assertEqual(result["D$ Prefetch Pollution"], "0")
+
+    def test_stride(self):
+        # 間隔 3 條 line：前 4 次 miss 把 stride 確認兩次，之後每次都 prefetch 下一條
+        result = stats(["--dc=1:16:8:lru:pf=stride"], self.sequential(3))
+        self.assertEqual(result["D$ Read Misses"], "4")
+        self.assertEqual(result["D$ Prefetches"], "5")
+        self.assertEqual(result["D$ Useful Prefetches"], "4")
+
+
+class three_c_test(unittest.TestCase):
+    # 2 個 set 的 direct-mapped，shadow 是 2 條 line 的 fully-associative LRU
+    #   0、10 第一次：compulsory；0 再讀：0 和 10 搶 set 0，shadow 還有 0，conflict
+    #   8、20 第一次：compulsory，shadow 把 10、0 擠掉；0 再讀：shadow 也沒有，capacity
+    #   很遠的 line (另一頁 bitmap) 第一次：compulsory；10 再讀：capacity
+    def test_classes(self):
+        trace = "0 8 L\n10 8 L\n0 8 L\n8 8 L\n20 8 L\n0 8 L\n7f00000000 8 L\n10 8 L\n"
+        result = stats(["--dc=2:1:8:lru:3c=1"], trace)
+        self.assertEqual(result["D$ Read Misses"], "8")
+        self.assertEqual(result["D$ Compulsory Misses"], "5")
+        self.assertEqual(result["D$ Capacity Misses"], "2")
+        self.assertEqual(result["D$ Conflict Misses"], "1")
+
+
+class index_test(unittest.TestCase):
+    # 4 個 set 的 direct-mapped，line 0、4、8、12 (間隔 4 條 line) 各讀兩次
+    # mod 全部擠在 set 0；xor 把上面的 bits 摺下來，剛好一個 set 一條
+    TRACE = "0 8 L\n20 8 L\n40 8 L\n60 8 L\n" * 2
+
+    def sets(self, index):
+        # heatmap=1 把每個 set 的次數寫到目前目錄的 D.sets.csv
+        with tempfile.TemporaryDirectory() as cwd:
+            output = subprocess.run([TRACESIM, "--dc=4:1:8:lru:heatmap=1:index=" + index, "-"],
+                                    input=self.TRACE, capture_output=True, text=True, cwd=cwd)
+            self.assertEqual(output.returncode, 0, output.stderr)
+            with open(os.path.join(cwd, "D.sets.csv")) as f:
+                rows = f.read().splitlines()[1:]
+        return [(int(r.split(",")[1]), int(r.split(",")[2])) for r in rows]
+
+    def test_mod(self):
+        self.assertEqual(self.sets("mod"), [(8, 8), (0, 0), (0, 0), (0, 0)])
+
+    def test_xor(self):
+        self.assertEqual(self.sets("xor"), [(2, 1), (2, 1), (2, 1), (2, 1)])
+
+
+class lfu_test(unittest.TestCase):
+    # 寫入 miss 放進來的 line 跟讀取 miss 放進來的一樣，次數從 0 開始：
+    # 1 個 set 2 個 way，A、B 都是 0 次，C 換掉比較舊的 A，A 再讀一次還是 miss
+    # 如果寫入 miss 算一次 hit，A 會變成 1 次，C 換掉的是 B，A 就 hit 了
+    def test_store_allocate_is_not_a_reuse(self):
+        stored = "0 8 S\n8 8 L\n10 8 L\n0 8 L\n"
+        loaded = "0 8 L\n8 8 L\n10 8 L\n0 8 L\n"
+        self.assertEqual(dcache_misses("1:2:8:lfu", loaded), 4)
+        self.assertEqual(dcache_misses("1:2:8:lfu", stored), 4)
+
+
+class wide_tag_test(unittest.TestCase):
+    # line address 超過 32 bits (64-byte block 時 256 GiB 以上) 的存取要照樣模擬，不能結束程式
+    # 先放幾條低位址的 line 再放高位址的，中途換成 64-bit tag 之後結果要跟整個平移到低位址一樣
+    def test_high_addresses(self):
+        low = "".join("%x 8 %s\n" % (a, t) for a, t in
+                      [(0x0, "S"), (0x40, "L"), (0x80, "L"), (0x0, "L"), (0xc0, "S"), (0x40, "L")])
+        high = "".join("%x %s" % (int(l.split()[0], 16) + 0x7f00000000, l.split(" ", 1)[1])
+                       for l in low.splitlines(True))
+        shifted = "".join("%x %s" % (int(l.split()[0], 16) + 0x100000, l.split(" ", 1)[1])
+                          for l in low.splitlines(True))
+        for policy in ["lru", "fifo", "lfu", "srrip"]:
+            config = "2:2:64:" + policy
+            self.assertEqual(dcache_misses(config, low + high), dcache_misses(config, low + shifted))
+
+
+class rrip_test(unittest.TestCase):
+    # 寫入 miss 放進來的 line 要跟讀取 miss 一樣放在 RRPV 2，不能當成 hit 升到 0
+    # 1 個 set 4 個 way：0 放進來之後掃過 5 條新的 line，0 要被擠掉，回來讀的時候還是 miss
+    def test_store_then_scan(self):
+        scan = "".join("%x 8 L\n" % (8 * i) for i in range(1, 6)) + "0 8 L\n"
+        for policy in ["srrip", "drrip"]:
+            config = "1:4:8:" + policy
+            self.assertEqual(dcache_misses(config, "0 8 S\n" + scan), 7)
+            self.assertEqual(dcache_misses(config, "0 8 L\n" + scan), 7)
+
+
+class memtrace_test(unittest.TestCase):
+    # memtrace.h 的格式：24 bytes 的 file header，接著每個 block 是 (bytes, records) 兩個 uint32 + payload
+    FILE_HEADER = 24
+    BLOCK_HEADER = 8
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.dir.name, "a.mtr")
+        trace = "".join("%x 8 %s\n" % (0x80000000 + 8 * i, "LSF"[i % 3]) for i in range(64))
+        output = run(["--record=" + self.path], trace)
+        self.assertEqual(output.returncode, 0, output.stderr)
+        with open(self.path, "rb") as f:
+            self.data = f.read()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def replay(self, data):
+        # 檔案走 mmap，stdin 走 fread，兩種讀法都要擋下來
+        with open(self.path, "wb") as f:
+            f.write(data)
+        by_file = subprocess.run([TRACESIM, "--dc=1:4:8", self.path], capture_output=True, text=True)
+        by_pipe = subprocess.run([TRACESIM, "--dc=1:4:8", "-"], input=data, capture_output=True)
+        return by_file, by_pipe
+
+    def block_header(self):
+        return struct.unpack_from("<II", self.data, self.FILE_HEADER)
+
+    def test_intact(self):
+        for output in self.replay(self.data):
+            self.assertEqual(output.returncode, 0)
+
+    def test_records_overstated(self):
+        # block header 說的筆數比 payload 裡的多
+        nbytes, records = self.block_header()
+        data = bytearray(self.data)
+        struct.pack_into("<II", data, self.FILE_HEADER, nbytes, records + 1000)
+        for output in self.replay(bytes(data)):
+            self.assertEqual(output.returncode, 1)
+
+    def test_truncated_block(self):
+        # payload 砍掉後半，block header 的 bytes 跟著改小，最後一筆 record 的 varint 會停在半路
+        nbytes, records = self.block_header()
+        half = nbytes // 2
+        data = bytearray(self.data[:self.FILE_HEADER + self.BLOCK_HEADER + half])
+        data[-1] |= 0x80
+        struct.pack_into("<II", data, self.FILE_HEADER, half, records)
+        for output in self.replay(bytes(data)):
+            self.assertEqual(output.returncode, 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,259 @@
+// See LICENSE for license details.
+
+// tracesim：不用跑 spike + pk，直接把錄好的 memory trace 餵給 cache_sim_t
+// cache 的部分跟 spike 用的是同一份 cachesim.cc，接法也跟 spike 一樣
+// (--ic / --dc 掛在 memtracer_list_t 上，--l2 當作它們的 miss handler)
+//
+// trace 可以是 memtrace.h 的二進位格式 (spike 用 CACHESIM_TRACE 錄的)，
+// 或是文字檔，一行一筆存取：
+//   <addr (hex)> <bytes> <type>
+// type 是 L (load)、S (store)、F (fetch)，# 開頭的行會被忽略
+// --record 可以把重播的內容再錄成二進位格式，拿來把文字 trace 轉檔
+// --ic / --dc 也可以是 L1D=...,L2=...,L3=... 的一整串 cache (見 cachesim.h 的 cache_hierarchy_t)
+// --lru-sweep 用 stack distance 一次算完 bf.sh 那張 LRU 的表 (見 stackdist.h)
+
+#include "cachesim.h"
+#include "memtracer.h"
+#include "memtrace.h"
+#include "stackdist.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+static void help(const char* prog)
+{
+  std::cerr << "usage: " << prog << " [options] <trace file | ->" << std::endl;
+  std::cerr << "       " << prog << " --lru-sweep[=<bytes>] <trace file>..." << std::endl;
+  std::cerr << "  --ic=<S>:<W>:<B>[:<policy>]...   Instantiate a cache model for the I$" << std::endl;
+  std::cerr << "  --dc=<S>:<W>:<B>[:<policy>]...   Instantiate a cache model for the D$" << std::endl;
+  std::cerr << "  --l2=<S>:<W>:<B>[:<policy>]...   Instantiate an L2 behind the I$/D$" << std::endl;
+  std::cerr << "  --ic=L1I=<config>,L2=<config>,...[,mem=<cycles>]" << std::endl;
+  std::cerr << "  --dc=L1D=<config>,L2=<config>,...[,mem=<cycles>]" << std::endl;
+  std::cerr << "                                   Instantiate a whole cache hierarchy and print its AMAT" << std::endl;
+  std::cerr << "  --log-cache-miss                 Print every miss to stderr" << std::endl;
+  std::cerr << "  --record=<file>                  Write the replayed accesses as a binary trace" << std::endl;
+  std::cerr << "  --lru-sweep[=<bytes>]            Print the bf.sh LRU miss-rate table for a D$ of" << std::endl;
+  std::cerr << "                                   <bytes> (default 64), averaged over all traces" << std::endl;
+  exit(1);
+}
+
+// 把 type 欄位轉成 access_type，看第一個字就好 (L / load、S / store、F / fetch)
+static bool parse_type(const char* s, access_type* type)
+{
+  switch (*s) {
+    case 'L': case 'l': case 'R': case 'r': *type = LOAD; return true;
+    case 'S': case 's': case 'W': case 'w': *type = STORE; return true;
+    case 'F': case 'f': case 'I': case 'i': *type = FETCH; return true;
+  }
+  return false;
+}
+
+static uint64_t replay_text(FILE* f, memtracer_t* tracer)
+{
+  char line[256];
+  uint64_t n = 0;
+  for (uint64_t lineno = 1; fgets(line, sizeof(line), f); lineno++) {
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+
+    uint64_t addr;
+    size_t bytes;
+    char type_str[16];
+    access_type type;
+    if (sscanf(line, "%" SCNx64 " %zu %15s", &addr, &bytes, type_str) != 3 ||
+        !parse_type(type_str, &type)) {
+      std::cerr << "trace line " << lineno << ": expected <addr> <bytes> <L|S|F>" << std::endl;
+      exit(1);
+    }
+
+    tracer->trace(addr, bytes, type);
+    n++;
+  }
+  return n;
+}
+
+// 二進位 trace 檔案：mmap 起來，一次解碼一整個 block 再丟給 cache
+static uint64_t replay_mapped(const char* path, memtracer_t* tracer)
+{
+  memtrace_reader_t reader(path);
+  std::vector<memtrace_record_t> batch(MEMTRACE_BLOCK_RECORDS);
+  uint64_t n = 0;
+  while (size_t len = reader.next_batch(batch.data())) {
+    for (const memtrace_record_t* r = batch.data(); r != batch.data() + len; r++)
+      tracer->trace(r->addr, r->bytes, access_type(r->type));
+    n += len;
+  }
+  return n;
+}
+
+// 從 pipe 讀進來的二進位 trace 沒辦法 mmap，一次 fread 一整個 block
+static uint64_t replay_binary(FILE* f, const char* path, memtracer_t* tracer)
+{
+  memtrace_file_header_t header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, MEMTRACE_MAGIC, sizeof(MEMTRACE_MAGIC)) != 0 ||
+      header.version != MEMTRACE_VERSION) {
+    std::cerr << path << ": unsupported memory trace version" << std::endl;
+    exit(1);
+  }
+
+  std::vector<uint8_t> payload;
+  memtrace_block_header_t bh;
+  uint64_t n = 0;
+  while (fread(&bh, sizeof(bh), 1, f) == 1) {
+    payload.resize(bh.bytes);
+    if (fread(payload.data(), 1, bh.bytes, f) != bh.bytes) {
+      std::cerr << path << ": truncated memory trace" << std::endl;
+      exit(1);
+    }
+    if (bh.records > MEMTRACE_BLOCK_RECORDS ||
+        !memtrace_decode_block(payload.data(), payload.data() + bh.bytes, bh.records,
+          [tracer](uint64_t addr, size_t bytes, access_type type) { tracer->trace(addr, bytes, type); })) {
+      std::cerr << path << ": corrupt memory trace block" << std::endl;
+      exit(1);
+    }
+    n += bh.records;
+  }
+  return n;
+}
+
+static bool is_binary_trace(FILE* f)
+{
+  int c = getc(f);
+  if (c != EOF)
+    ungetc(c, f);
+  return c == MEMTRACE_MAGIC[0];
+}
+
+// 依照檔案內容選擇文字 / mmap / pipe 的讀法，把整個 trace 丟給 tracer
+static uint64_t replay(const char* trace_file, memtracer_t* tracer)
+{
+  FILE* f = strcmp(trace_file, "-") == 0 ? stdin : fopen(trace_file, "r");
+  if (!f) {
+    std::cerr << "could not open " << trace_file << std::endl;
+    exit(1);
+  }
+  uint64_t n;
+  if (!is_binary_trace(f))
+    n = replay_text(f, tracer);
+  else if (f != stdin) {
+    fclose(f);
+    return replay_mapped(trace_file, tracer);
+  } else
+    n = replay_binary(f, trace_file, tracer);
+  if (f != stdin)
+    fclose(f);
+  return n;
+}
+
+// 跟 test.py 印出來的 miss rate 一樣：str(round(x, 4))
+static std::string py_round4(double x)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.4f", x);
+  std::string s(buf);
+  while (s.back() == '0' && s[s.size()-2] != '.')
+    s.pop_back();
+  return s;
+}
+
+// 一次走過每個 trace，印出跟 bf.sh 的 outputlru.txt 一樣的表
+// 跟 test.py 一樣，每個 trace 的 miss rate 先照 print_stats 印到小數第三位，再對所有 trace 取平均
+static void lru_sweep(size_t capacity, const std::vector<const char*>& trace_files)
+{
+  std::vector<double> avg;
+  for (const char* trace_file : trace_files) {
+    lru_sweep_t sweep(capacity);
+    replay(trace_file, &sweep);
+    avg.resize(sweep.size(), 0);
+    for (size_t i = 0; i < sweep.size(); i++) {
+      const lru_stack_t& s = sweep.stack(i);
+      float mr = s.accesses() ? 100.0f*s.misses(sweep.point(i).ways)/s.accesses() : 0;
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.3f", mr);
+      avg[i] += atof(buf) / trace_files.size();
+    }
+  }
+
+  lru_sweep_t sweep(capacity);
+  for (size_t i = 0; i < sweep.size(); i++) {
+    const lru_sweep_t::point_t& p = sweep.point(i);
+    std::cout << "=======================================================================" << std::endl;
+    std::cout << "Data Cache Setting with: " << p.sets << ":" << p.ways << ":" << p.linesz << std::endl;
+    std::cout << "Miss Rate: " << py_round4(avg[i]) << " %" << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* ic_config = NULL;
+  const char* dc_config = NULL;
+  const char* l2_config = NULL;
+  std::vector<const char*> trace_files;
+  const char* record_file = NULL;
+  size_t sweep_capacity = 0;
+  bool log_cache = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--ic=", 5) == 0)
+      ic_config = argv[i] + 5;
+    else if (strncmp(argv[i], "--dc=", 5) == 0)
+      dc_config = argv[i] + 5;
+    else if (strncmp(argv[i], "--l2=", 5) == 0)
+      l2_config = argv[i] + 5;
+    else if (strcmp(argv[i], "--log-cache-miss") == 0)
+      log_cache = true;
+    else if (strncmp(argv[i], "--record=", 9) == 0)
+      record_file = argv[i] + 9;
+    else if (strcmp(argv[i], "--lru-sweep") == 0)
+      sweep_capacity = 64;
+    else if (strncmp(argv[i], "--lru-sweep=", 12) == 0)
+      sweep_capacity = atoi(argv[i] + 12);
+    else if (argv[i][0] == '-' && argv[i][1] != '\0')
+      help(argv[0]);
+    else
+      trace_files.push_back(argv[i]);
+  }
+
+  if (sweep_capacity) {
+    if (trace_files.empty() || sweep_capacity < 8 || (sweep_capacity & (sweep_capacity-1)))
+      help(argv[0]);
+    lru_sweep(sweep_capacity, trace_files);
+    return 0;
+  }
+  if (trace_files.size() != 1 || (!ic_config && !dc_config && !record_file))
+    help(argv[0]);
+
+  // 宣告順序跟 spike.cc 一樣，結束時依 L2$、D$、I$ 的順序印出統計資料
+  std::unique_ptr<icache_sim_t> ic;
+  std::unique_ptr<dcache_sim_t> dc;
+  std::unique_ptr<cache_sim_t> l2;
+  std::unique_ptr<memtrace_recorder_t> recorder;
+  memtracer_list_t tracers;
+
+  if (ic_config) ic.reset(new icache_sim_t(ic_config));
+  if (dc_config) dc.reset(new dcache_sim_t(dc_config));
+  if (l2_config) l2.reset(cache_sim_t::construct(l2_config, "L2$"));
+  if (ic) {
+    if (l2) ic->set_miss_handler(&*l2);
+    ic->set_log(log_cache);
+    tracers.hook(&*ic);
+  }
+  if (dc) {
+    if (l2) dc->set_miss_handler(&*l2);
+    dc->set_log(log_cache);
+    tracers.hook(&*dc);
+  }
+  if (record_file) {
+    recorder.reset(new memtrace_recorder_t(record_file));
+    tracers.hook(&*recorder);
+  }
+
+  replay(trace_files[0], &tracers);
+  return 0;
+}